@@ -157,6 +157,10 @@ function( common_compiler_flags )
             $<${IS_MSVC}:$<${DISABLE_EXCEPTIONS}:_HAS_EXCEPTIONS=0>>
 
             $<${THREADS_ENABLED}:THREADS_ENABLED>
+
+            $<${MEMORY_POOL_ENABLED}:MEMORY_POOL_ENABLED>
+            $<${MEMORY_PROFILER_ENABLED}:MEMORY_PROFILER_ENABLED>
+            $<${SPIN_LOCK_STATS_ENABLED}:SPIN_LOCK_STATS_ENABLED>
     )
 
     target_link_options( ${TARGET_NAME}
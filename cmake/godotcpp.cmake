@@ -122,6 +122,15 @@ function( godotcpp_options )
 
     set( GODOTCPP_THREADS ON CACHE BOOL "Enable threading support" )
 
+    option( GODOTCPP_USE_MEMORY_POOL
+            "Serve small allocations from an extension-side pool with per-thread caches instead of the engine allocator. (ON|OFF)" OFF )
+
+    option( GODOTCPP_USE_MEMORY_PROFILER
+            "Record the call site, size and thread of every allocation made through Memory. (ON|OFF)" OFF )
+
+    option( GODOTCPP_USE_SPIN_LOCK_STATS
+            "Count acquisitions, contentions, spins and the longest wait of every SpinLock and RWSpinLock. (ON|OFF)" OFF )
+
     #TODO compiledb
     #TODO compiledb_file
 
@@ -277,6 +286,10 @@ function( godotcpp_generate )
 
     set( THREADS_ENABLED "$<BOOL:${GODOTCPP_THREADS}>" )
 
+    set( MEMORY_POOL_ENABLED "$<BOOL:${GODOTCPP_USE_MEMORY_POOL}>" )
+    set( MEMORY_PROFILER_ENABLED "$<BOOL:${GODOTCPP_USE_MEMORY_PROFILER}>" )
+    set( SPIN_LOCK_STATS_ENABLED "$<BOOL:${GODOTCPP_USE_SPIN_LOCK_STATS}>" )
+
     # GODOTCPP_DEV_BUILD
     set( RELEASE_TYPES "Release;MinSizeRel")
     get_property( IS_MULTI_CONFIG GLOBAL PROPERTY GENERATOR_IS_MULTI_CONFIG )
@@ -35,6 +35,7 @@
 
 #include <godot_cpp/core/defs.hpp>
 #include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/memory_profiler.hpp>
 #include <godot_cpp/core/method_bind.hpp>
 #include <godot_cpp/core/object.hpp>
 #include <godot_cpp/core/print_string.hpp>
@@ -49,6 +50,7 @@
 #include <mutex>
 #include <set>
 #include <string>
+#include <typeinfo>
 #include <unordered_map>
 #include <vector>
 
@@ -125,7 +127,13 @@ private:
 	static GDExtensionObjectPtr _create_instance_func(void *data, GDExtensionBool p_notify_postinitialize) {
 		if constexpr (!std::is_abstract_v<T>) {
 			Wrapped::_set_construct_info<T>();
+#if defined(MEMORY_PROFILER_ENABLED) && !defined(NO_SAFE_CAST)
+			// Attribute the instances to their class in the memory profiler.
+			static const char *description = MemoryProfiler::get_type_description(typeid(T).name());
+			T *new_object = new ("", description) T;
+#else
 			T *new_object = new ("", "") T;
+#endif
 			if (p_notify_postinitialize) {
 				new_object->_postinitialize();
 			}
@@ -44,6 +44,9 @@
 void *operator new(size_t p_size, const char *p_dummy, const char *p_description); ///< operator new that takes a description and uses MemoryStaticPool
 void *operator new(size_t p_size, const char *p_dummy, void *(*p_allocfunc)(size_t p_size)); ///< operator new that takes a description and uses MemoryStaticPool
 void *operator new(size_t p_size, const char *p_dummy, void *p_pointer, size_t check, const char *p_description); ///< operator new that takes a description and uses a pointer to the preallocated memory
+#ifdef MEMORY_PROFILER_ENABLED
+void *operator new(size_t p_size, const char *p_dummy, void *(*p_allocfunc)(size_t p_size), const char *p_description); ///< operator new that takes a description and uses MemoryStaticPool
+#endif
 
 _ALWAYS_INLINE_ void *operator new(size_t p_size, const char *p_dummy, void *p_pointer, size_t check, const char *p_description) {
 	return p_pointer;
@@ -55,6 +58,9 @@ _ALWAYS_INLINE_ void *operator new(size_t p_size, const char *p_dummy, void *p_p
 void operator delete(void *p_mem, const char *p_dummy, const char *p_description);
 void operator delete(void *p_mem, const char *p_dummy, void *(*p_allocfunc)(size_t p_size));
 void operator delete(void *p_mem, const char *p_dummy, void *p_pointer, size_t check, const char *p_description);
+#ifdef MEMORY_PROFILER_ENABLED
+void operator delete(void *p_mem, const char *p_dummy, void *(*p_allocfunc)(size_t p_size), const char *p_description);
+#endif
 #endif
 
 namespace godot {
@@ -77,9 +83,15 @@ public:
 	static constexpr size_t ELEMENT_OFFSET = ((SIZE_OFFSET + sizeof(uint64_t)) % alignof(uint64_t) == 0) ? (SIZE_OFFSET + sizeof(uint64_t)) : ((SIZE_OFFSET + sizeof(uint64_t)) + alignof(uint64_t) - ((SIZE_OFFSET + sizeof(uint64_t)) % alignof(uint64_t)));
 	static constexpr size_t DATA_OFFSET = ((ELEMENT_OFFSET + sizeof(uint64_t)) % alignof(max_align_t) == 0) ? (ELEMENT_OFFSET + sizeof(uint64_t)) : ((ELEMENT_OFFSET + sizeof(uint64_t)) + alignof(max_align_t) - ((ELEMENT_OFFSET + sizeof(uint64_t)) % alignof(max_align_t)));
 
-	static void *alloc_static(size_t p_bytes, bool p_pad_align = false);
-	static void *realloc_static(void *p_memory, size_t p_bytes, bool p_pad_align = false);
+	// p_description is only used by the memory profiler (see MemoryProfiler).
+	static void *alloc_static(size_t p_bytes, bool p_pad_align = false, const char *p_description = "");
+	static void *realloc_static(void *p_memory, size_t p_bytes, bool p_pad_align = false, const char *p_description = "");
 	static void free_static(void *p_ptr, bool p_pad_align = false);
+
+	// Alignment must be a power of 2. Memory returned by these functions must only be released with free_aligned_static.
+	static void *alloc_aligned_static(size_t p_bytes, size_t p_alignment, const char *p_description = "");
+	static void *realloc_aligned_static(void *p_memory, size_t p_bytes, size_t p_prev_bytes, size_t p_alignment, const char *p_description = "");
+	static void free_aligned_static(void *p_memory);
 };
 
 template <typename T, std::enable_if_t<!std::is_base_of<::godot::Wrapped, T>::value, bool> = true>
@@ -93,13 +105,22 @@ _ALWAYS_INLINE_ T *_post_initialize(T *p_obj) {
 	return p_obj;
 }
 
-#define memalloc(m_size) ::godot::Memory::alloc_static(m_size)
-#define memrealloc(m_mem, m_size) ::godot::Memory::realloc_static(m_mem, m_size)
+#ifdef MEMORY_PROFILER_ENABLED
+// Description of the allocations made by the memory macros, recorded by MemoryProfiler.
+#define _MEM_CALL_SITE __FILE__ ":" _MKSTR(__LINE__)
+#define _MEM_ALLOCATOR_ARGS(m_allocator) m_allocator::alloc, _MEM_CALL_SITE
+#else
+#define _MEM_CALL_SITE ""
+#define _MEM_ALLOCATOR_ARGS(m_allocator) m_allocator::alloc
+#endif
+
+#define memalloc(m_size) ::godot::Memory::alloc_static(m_size, false, _MEM_CALL_SITE)
+#define memrealloc(m_mem, m_size) ::godot::Memory::realloc_static(m_mem, m_size, false, _MEM_CALL_SITE)
 #define memfree(m_mem) ::godot::Memory::free_static(m_mem)
 
-#define memnew(m_class) (::godot::_pre_initialize<std::remove_pointer_t<decltype(new ("", "") m_class)>>(), ::godot::_post_initialize(new ("", "") m_class))
+#define memnew(m_class) (::godot::_pre_initialize<std::remove_pointer_t<decltype(new ("", "") m_class)>>(), ::godot::_post_initialize(new ("", _MEM_CALL_SITE) m_class))
 
-#define memnew_allocator(m_class, m_allocator) (::godot::_pre_initialize<std::remove_pointer_t<decltype(new ("", "") m_class)>>(), ::godot::_post_initialize(new ("", m_allocator::alloc) m_class))
+#define memnew_allocator(m_class, m_allocator) (::godot::_pre_initialize<std::remove_pointer_t<decltype(new ("", "") m_class)>>(), ::godot::_post_initialize(new ("", _MEM_ALLOCATOR_ARGS(m_allocator)) m_class))
 #define memnew_placement(m_placement, m_class) (::godot::_pre_initialize<std::remove_pointer_t<decltype(new ("", "") m_class)>>(), ::godot::_post_initialize(new ("", m_placement, sizeof(m_class), "") m_class))
 
 // Generic comparator used in Map, List, etc.
@@ -145,7 +166,7 @@ public:
 	_ALWAYS_INLINE_ void delete_allocation(T *p_allocation) { memdelete(p_allocation); }
 };
 
-#define memnew_arr(m_class, m_count) memnew_arr_template<m_class>(m_count)
+#define memnew_arr(m_class, m_count) memnew_arr_template<m_class>(m_count, _MEM_CALL_SITE)
 
 _FORCE_INLINE_ uint64_t *_get_element_count_ptr(uint8_t *p_ptr) {
 	return (uint64_t *)(p_ptr - Memory::DATA_OFFSET + Memory::ELEMENT_OFFSET);
@@ -160,7 +181,7 @@ T *memnew_arr_template(size_t p_elements, const char *p_descr = "") {
 	same strategy used by std::vector, and the Vector class, so it should be safe.*/
 
 	size_t len = sizeof(T) * p_elements;
-	uint8_t *mem = (uint8_t *)Memory::alloc_static(len, true);
+	uint8_t *mem = (uint8_t *)Memory::alloc_static(len, true, p_descr);
 	T *failptr = nullptr; // Get rid of a warning.
 	ERR_FAIL_NULL_V(mem, failptr);
 
@@ -0,0 +1,92 @@
+/**************************************************************************/
+/*  memory_pool.hpp                                                       */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_MEMORY_POOL_HPP
+#define GODOT_MEMORY_POOL_HPP
+
+#include <godot_cpp/core/defs.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef MEMORY_POOL_ENABLED
+
+namespace godot {
+
+// Extension-side allocator used by Memory::alloc_static, realloc_static and
+// free_static when building with `use_memory_pool=yes` (MEMORY_POOL_ENABLED).
+//
+// Small blocks are served from size classes backed by slabs requested from the
+// engine, with a per-thread cache in front of a shared pool so that most
+// allocations and frees never take a lock nor cross the engine boundary.
+// Blocks larger than MAX_SMALL_SIZE are forwarded to the engine allocator.
+//
+// Every block is preceded by a small header holding its size class, so any
+// pointer passed to free() or realloc() must come from alloc().
+class MemoryPool {
+	MemoryPool();
+
+public:
+	static constexpr size_t HEADER_SIZE = alignof(max_align_t) > sizeof(uint64_t) ? alignof(max_align_t) : sizeof(uint64_t);
+	static constexpr size_t MAX_SMALL_SIZE = 1024;
+	static constexpr uint32_t SIZE_CLASS_COUNT = 28;
+	static constexpr uint32_t LARGE_SIZE_CLASS = 0xFFFFFFFF;
+	static constexpr size_t SLAB_SIZE = 65536;
+
+	// Size classes are 16 byte apart up to 256 bytes, then 64 byte apart up to MAX_SMALL_SIZE.
+	static _FORCE_INLINE_ uint32_t get_size_class(size_t p_bytes) {
+		if (p_bytes <= 256) {
+			return p_bytes == 0 ? 0 : uint32_t((p_bytes - 1) >> 4);
+		}
+		return 16 + uint32_t((p_bytes - 257) >> 6);
+	}
+
+	static _FORCE_INLINE_ size_t get_size_class_bytes(uint32_t p_size_class) {
+		return p_size_class < 16 ? size_t(p_size_class + 1) << 4 : 256 + (size_t(p_size_class - 15) << 6);
+	}
+
+	static void *alloc(size_t p_bytes);
+	static void *realloc(void *p_memory, size_t p_bytes);
+	static void free(void *p_ptr);
+
+	// Returns the blocks cached by the calling thread to the shared pool.
+	// Threads created by the extension should call this before exiting,
+	// otherwise their cached blocks can't be reused by other threads.
+	static void flush_thread_cache();
+
+	// Total bytes requested from the engine for slabs.
+	static uint64_t get_slab_memory();
+};
+
+} // namespace godot
+
+#endif // MEMORY_POOL_ENABLED
+
+#endif // GODOT_MEMORY_POOL_HPP
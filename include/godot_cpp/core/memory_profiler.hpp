@@ -0,0 +1,108 @@
+/**************************************************************************/
+/*  memory_profiler.hpp                                                   */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_MEMORY_PROFILER_HPP
+#define GODOT_MEMORY_PROFILER_HPP
+
+#include <godot_cpp/core/defs.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef MEMORY_PROFILER_ENABLED
+
+namespace godot {
+
+// Allocation tracking used by Memory::alloc_static, realloc_static and
+// free_static when building with `use_memory_profiler=yes` (MEMORY_PROFILER_ENABLED).
+//
+// Every allocation is attributed to a site: the description passed by memnew,
+// memalloc, memrealloc and memnew_arr (`file:line` of the call) or, when the
+// allocation has no description, the return address of Memory::alloc_static.
+// Sites keep the live bytes and count, the totals, the threads that allocated
+// from them and the allocations made during the last frame.
+//
+// Allocations are preceded by a HEADER_SIZE header holding their site, size and
+// thread. Recording is lock free, the site table has a fixed capacity and any
+// site past it is accounted to a single "<overflow>" site.
+class MemoryProfiler {
+	MemoryProfiler();
+
+public:
+	static constexpr size_t HEADER_SIZE = alignof(max_align_t) > 32 ? alignof(max_align_t) : 32;
+	static constexpr uint32_t MAX_SITES = 8192;
+
+	struct SiteInfo {
+		const char *description = nullptr; // `nullptr` if the site is only known by `address`.
+		const void *address = nullptr;
+		uint64_t live_bytes = 0;
+		uint64_t live_count = 0;
+		uint64_t total_bytes = 0;
+		uint64_t total_count = 0;
+		uint64_t frame_bytes = 0; // Allocated during the last frame, see next_frame().
+		uint64_t frame_count = 0;
+		uint32_t thread_count = 0; // Approximate, threads are hashed to 64 buckets.
+	};
+
+	// Hooks for Memory, `p_header` is the start of the block allocated with HEADER_SIZE extra bytes.
+	static void record_alloc(void *p_header, size_t p_bytes, const char *p_description, const void *p_address);
+	static void record_free(void *p_header);
+	// The site of a reallocated block is kept, record_free() must be called on the block first.
+	static void record_realloc(void *p_header, size_t p_bytes);
+
+	// Readable description of a type from `typeid(T).name()`, demangled when
+	// the compiler mangles it. Results are never freed, call it once per type.
+	static const char *get_type_description(const char *p_type_name);
+
+	// Site used by allocations without a description made by the calling thread
+	// until pop_site(), e.g. the allocator function passed to memnew_allocator.
+	static void push_site(const char *p_description);
+	static void pop_site();
+
+	// Closes the current frame, the per-frame counters of every site then report it.
+	// Meant to be called once per frame, e.g. from a `_process` callback.
+	static void next_frame();
+
+	// Fills r_sites with up to p_max sites sorted by live bytes, largest first,
+	// and returns how many were written. Sites with the same description are merged.
+	static uint32_t get_top_sites(SiteInfo *r_sites, uint32_t p_max);
+
+	// Writes every site to a text file, sorted by live bytes. Returns false if it can't be opened.
+	static bool dump(const char *p_path);
+
+	static uint64_t get_live_bytes();
+	static uint64_t get_live_count();
+};
+
+} // namespace godot
+
+#endif // MEMORY_PROFILER_ENABLED
+
+#endif // GODOT_MEMORY_PROFILER_HPP
@@ -0,0 +1,251 @@
+/**************************************************************************/
+/*  arena_allocator.hpp                                                   */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_ARENA_ALLOCATOR_HPP
+#define GODOT_ARENA_ALLOCATOR_HPP
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/core/memory.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace godot {
+
+/**
+ * Monotonic memory region. Allocations bump a pointer inside chunks that
+ * are all released at once by reset(), individual allocations are never freed.
+ *
+ * Chunks grow geometrically, so the amount of chunks stays small and reset()
+ * keeps only the largest one, which is usually enough to fit the whole
+ * workload the next time the arena is used.
+ */
+class Arena {
+	friend class ArenaAllocator;
+	friend class ArenaScope;
+
+	struct Chunk {
+		Chunk *next = nullptr;
+		size_t size = 0;
+	};
+
+	static constexpr size_t ALIGN = alignof(max_align_t);
+	static constexpr size_t CHUNK_HEADER_SIZE = (sizeof(Chunk) + ALIGN - 1) & ~(ALIGN - 1);
+
+	Chunk *chunks = nullptr; // Most recent first.
+	uint8_t *pos = nullptr;
+	uint8_t *end = nullptr;
+	size_t next_chunk_size = 0;
+	size_t used = 0;
+
+	Arena *parent = nullptr; // Enclosing arena while in an ArenaScope.
+	bool in_scope = false;
+
+	_FORCE_INLINE_ static uint8_t *_get_chunk_data(Chunk *p_chunk) {
+		return (uint8_t *)p_chunk + CHUNK_HEADER_SIZE;
+	}
+
+	void *_alloc_chunk(size_t p_bytes) {
+		size_t size = MAX(next_chunk_size, p_bytes);
+		Chunk *chunk = (Chunk *)Memory::alloc_static(CHUNK_HEADER_SIZE + size);
+		ERR_FAIL_NULL_V(chunk, nullptr);
+		chunk->next = chunks;
+		chunk->size = size;
+		chunks = chunk;
+		next_chunk_size = size * 2;
+
+		pos = _get_chunk_data(chunk) + p_bytes;
+		end = _get_chunk_data(chunk) + size;
+		return _get_chunk_data(chunk);
+	}
+
+public:
+	static constexpr size_t DEFAULT_CHUNK_SIZE = 16384;
+
+	_FORCE_INLINE_ void *alloc(size_t p_bytes) {
+		p_bytes = (p_bytes + ALIGN - 1) & ~(ALIGN - 1);
+		used += p_bytes;
+		if (likely(p_bytes <= size_t(end - pos))) {
+			void *mem = pos;
+			pos += p_bytes;
+			return mem;
+		}
+		return _alloc_chunk(p_bytes);
+	}
+
+	bool owns(const void *p_ptr) const {
+		for (const Chunk *chunk = chunks; chunk; chunk = chunk->next) {
+			const uint8_t *data = (const uint8_t *)chunk + CHUNK_HEADER_SIZE;
+			if ((const uint8_t *)p_ptr >= data && (const uint8_t *)p_ptr < data + chunk->size) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Releases every allocation, keeping only the largest chunk for reuse.
+	void reset() {
+		if (!chunks) {
+			return;
+		}
+		Chunk *chunk = chunks->next;
+		while (chunk) {
+			Chunk *next = chunk->next;
+			Memory::free_static(chunk);
+			chunk = next;
+		}
+		chunks->next = nullptr;
+		pos = _get_chunk_data(chunks);
+		end = pos + chunks->size;
+		used = 0;
+	}
+
+	// Releases every allocation and all the chunks.
+	void clear() {
+		reset();
+		if (chunks) {
+			Memory::free_static(chunks);
+			chunks = nullptr;
+			pos = nullptr;
+			end = nullptr;
+		}
+	}
+
+	_FORCE_INLINE_ size_t get_used_memory() const { return used; }
+	size_t get_reserved_memory() const {
+		size_t reserved = 0;
+		for (const Chunk *chunk = chunks; chunk; chunk = chunk->next) {
+			reserved += chunk->size;
+		}
+		return reserved;
+	}
+
+	Arena(size_t p_chunk_size = DEFAULT_CHUNK_SIZE) {
+		next_chunk_size = p_chunk_size;
+	}
+	Arena(const Arena &) = delete;
+	void operator=(const Arena &) = delete;
+
+	~Arena() {
+		clear();
+	}
+};
+
+/**
+ * Allocator for the `A` template parameter of List, RBMap, RBSet and
+ * memnew_allocator. Allocations are served from the innermost ArenaScope
+ * of the calling thread, and freeing them is a no-op: the memory is released
+ * in one operation when the scope ends.
+ *
+ * Without an active scope it behaves like DefaultAllocator. Containers using
+ * it must not outlive the scope they allocated from.
+ */
+class ArenaAllocator {
+	friend class ArenaScope;
+
+#if defined(MACOS_ENABLED) && defined(HOT_RELOAD_ENABLED)
+	// Thread locals prevent unloading the library on macOS (see wrapped.hpp),
+	// and a shared scope would leak allocations across threads, so scopes are
+	// not supported there and ArenaAllocator always uses the heap.
+	static constexpr Arena *current = nullptr;
+#else
+	inline static thread_local Arena *current = nullptr;
+#endif
+
+public:
+	_FORCE_INLINE_ static void *alloc(size_t p_memory) {
+		Arena *arena = current;
+		if (arena) {
+			return arena->alloc(p_memory);
+		}
+		return Memory::alloc_static(p_memory);
+	}
+
+	_FORCE_INLINE_ static void free(void *p_ptr) {
+		for (const Arena *arena = current; arena; arena = arena->parent) {
+			if (arena->owns(p_ptr)) {
+				return; // Released with the arena.
+			}
+		}
+		Memory::free_static(p_ptr);
+	}
+
+	_FORCE_INLINE_ static Arena *get_current_arena() { return current; }
+};
+
+/**
+ * Makes an arena the target of ArenaAllocator on the calling thread until the
+ * scope ends, then resets it. Scopes can be nested. Passing a long lived Arena
+ * reuses its memory between scopes, e.g. once per frame.
+ */
+class ArenaScope {
+	Arena local_arena;
+	Arena *arena = nullptr;
+
+	void _enter(Arena *p_arena) {
+		CRASH_COND_MSG(p_arena->in_scope, "Arena is already used by an ArenaScope.");
+		arena = p_arena;
+		arena->in_scope = true;
+#if defined(MACOS_ENABLED) && defined(HOT_RELOAD_ENABLED)
+		ERR_PRINT_ONCE("ArenaScope is not supported with hot reload on macOS, ArenaAllocator will use the heap.");
+#else
+		arena->parent = ArenaAllocator::current;
+		ArenaAllocator::current = arena;
+#endif
+	}
+
+public:
+	_FORCE_INLINE_ Arena *get_arena() const { return arena; }
+
+	ArenaScope(size_t p_chunk_size = Arena::DEFAULT_CHUNK_SIZE) :
+			local_arena(p_chunk_size) {
+		_enter(&local_arena);
+	}
+	explicit ArenaScope(Arena &p_arena) {
+		_enter(&p_arena);
+	}
+	ArenaScope(const ArenaScope &) = delete;
+	void operator=(const ArenaScope &) = delete;
+
+	~ArenaScope() {
+#if !(defined(MACOS_ENABLED) && defined(HOT_RELOAD_ENABLED))
+		ERR_FAIL_COND_MSG(ArenaAllocator::current != arena, "ArenaScope destroyed out of order.");
+		ArenaAllocator::current = arena->parent;
+#endif
+		arena->parent = nullptr;
+		arena->in_scope = false;
+		arena->reset();
+	}
+};
+
+} // namespace godot
+
+#endif // GODOT_ARENA_ALLOCATOR_HPP
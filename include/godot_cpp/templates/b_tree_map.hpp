@@ -0,0 +1,796 @@
+/**************************************************************************/
+/*  b_tree_map.hpp                                                        */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_B_TREE_MAP_HPP
+#define GODOT_B_TREE_MAP_HPP
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/memory.hpp>
+#include <godot_cpp/templates/pair.hpp>
+
+#include <cstring>
+#include <type_traits>
+
+namespace godot {
+
+// Ordered map with the same lookup and iteration API as RBMap, stored as a B+ tree.
+//
+// Elements live in leaves holding several of them next to each other, and leaves
+// are linked, so ordered iteration and range queries (lower_bound() followed by
+// ++) walk contiguous memory instead of following one node per element. Inner
+// nodes only hold keys and children. Nodes are sized to a few cache lines.
+//
+// Unlike RBMap elements, elements move when the tree is modified: iterators are
+// invalidated by insert() and erase(). Like LocalVector, elements are relocated
+// with a plain memory copy.
+template <typename K, typename V, typename C = Comparator<K>, typename A = DefaultAllocator>
+class BTreeMap {
+public:
+	typedef KeyValue<K, V> ValueType;
+
+private:
+	static constexpr uint32_t NODE_SIZE = 256; // Four cache lines.
+	static constexpr uint32_t NODE_HEADER_SIZE = 2 * sizeof(void *) + sizeof(uint32_t) * 2;
+
+	static constexpr uint32_t _get_capacity(uint32_t p_element_size, uint32_t p_min) {
+		return (NODE_SIZE - NODE_HEADER_SIZE) / p_element_size > p_min ? (NODE_SIZE - NODE_HEADER_SIZE) / p_element_size : p_min;
+	}
+
+	static constexpr uint32_t LEAF_CAPACITY = _get_capacity(sizeof(ValueType), 4);
+	static constexpr uint32_t INNER_CAPACITY = _get_capacity(sizeof(K) + sizeof(void *), 7);
+	static constexpr uint32_t MIN_LEAF_COUNT = LEAF_CAPACITY / 2;
+	static constexpr uint32_t MIN_INNER_COUNT = (INNER_CAPACITY - 1) / 2;
+	// Non-root nodes have at least four children, so this is more than enough for 2^31 elements.
+	static constexpr uint32_t MAX_DEPTH = 32;
+
+	struct Node {
+		uint32_t count = 0;
+		bool leaf = false;
+	};
+
+	struct Leaf : public Node {
+		Leaf *next = nullptr;
+		Leaf *prev = nullptr;
+		alignas(ValueType) uint8_t data[LEAF_CAPACITY * sizeof(ValueType)];
+
+		_FORCE_INLINE_ ValueType *items() { return (ValueType *)data; }
+		_FORCE_INLINE_ const ValueType *items() const { return (const ValueType *)data; }
+
+		Leaf() { Node::leaf = true; }
+	};
+
+	// children[i] holds the keys lower than keys[i], and not lower than keys[i - 1].
+	struct Inner : public Node {
+		Node *children[INNER_CAPACITY + 1];
+		alignas(K) uint8_t data[INNER_CAPACITY * sizeof(K)];
+
+		_FORCE_INLINE_ K *keys() { return (K *)data; }
+		_FORCE_INLINE_ const K *keys() const { return (const K *)data; }
+	};
+
+	Node *_root = nullptr;
+	Leaf *_first = nullptr;
+	Leaf *_last = nullptr;
+	int _size = 0;
+
+public:
+	struct ConstIterator;
+
+	struct Iterator {
+		_FORCE_INLINE_ ValueType &operator*() const { return leaf->items()[index]; }
+		_FORCE_INLINE_ ValueType *operator->() const { return &leaf->items()[index]; }
+		_FORCE_INLINE_ Iterator &operator++() {
+			if (++index == leaf->count) {
+				leaf = leaf->next;
+				index = 0;
+			}
+			return *this;
+		}
+		_FORCE_INLINE_ Iterator &operator--() {
+			if (index == 0) {
+				leaf = leaf->prev;
+				index = leaf ? leaf->count - 1 : 0;
+			} else {
+				index--;
+			}
+			return *this;
+		}
+
+		_FORCE_INLINE_ Iterator next() const { return ++Iterator(*this); }
+		_FORCE_INLINE_ Iterator prev() const { return --Iterator(*this); }
+
+		_FORCE_INLINE_ const K &key() const { return leaf->items()[index].key; }
+		_FORCE_INLINE_ V &value() const { return leaf->items()[index].value; }
+		_FORCE_INLINE_ V &get() const { return leaf->items()[index].value; }
+		_FORCE_INLINE_ ValueType &key_value() const { return leaf->items()[index]; }
+
+		_FORCE_INLINE_ bool operator==(const Iterator &b) const { return leaf == b.leaf && index == b.index; }
+		_FORCE_INLINE_ bool operator!=(const Iterator &b) const { return leaf != b.leaf || index != b.index; }
+		explicit operator bool() const {
+			return leaf != nullptr;
+		}
+		Iterator(Leaf *p_leaf, uint32_t p_index) {
+			leaf = p_leaf;
+			index = p_index;
+		}
+		Iterator() {}
+
+	private:
+		friend class BTreeMap<K, V, C, A>;
+		friend struct ConstIterator;
+		Leaf *leaf = nullptr;
+		uint32_t index = 0;
+	};
+
+	struct ConstIterator {
+		_FORCE_INLINE_ const ValueType &operator*() const { return leaf->items()[index]; }
+		_FORCE_INLINE_ const ValueType *operator->() const { return &leaf->items()[index]; }
+		_FORCE_INLINE_ ConstIterator &operator++() {
+			if (++index == leaf->count) {
+				leaf = leaf->next;
+				index = 0;
+			}
+			return *this;
+		}
+		_FORCE_INLINE_ ConstIterator &operator--() {
+			if (index == 0) {
+				leaf = leaf->prev;
+				index = leaf ? leaf->count - 1 : 0;
+			} else {
+				index--;
+			}
+			return *this;
+		}
+
+		_FORCE_INLINE_ ConstIterator next() const { return ++ConstIterator(*this); }
+		_FORCE_INLINE_ ConstIterator prev() const { return --ConstIterator(*this); }
+
+		_FORCE_INLINE_ const K &key() const { return leaf->items()[index].key; }
+		_FORCE_INLINE_ const V &value() const { return leaf->items()[index].value; }
+		_FORCE_INLINE_ const V &get() const { return leaf->items()[index].value; }
+		_FORCE_INLINE_ const ValueType &key_value() const { return leaf->items()[index]; }
+
+		_FORCE_INLINE_ bool operator==(const ConstIterator &b) const { return leaf == b.leaf && index == b.index; }
+		_FORCE_INLINE_ bool operator!=(const ConstIterator &b) const { return leaf != b.leaf || index != b.index; }
+		explicit operator bool() const {
+			return leaf != nullptr;
+		}
+		ConstIterator(const Leaf *p_leaf, uint32_t p_index) {
+			leaf = p_leaf;
+			index = p_index;
+		}
+		ConstIterator(const Iterator &p_it) {
+			leaf = p_it.leaf;
+			index = p_it.index;
+		}
+		ConstIterator() {}
+
+	private:
+		friend class BTreeMap<K, V, C, A>;
+		const Leaf *leaf = nullptr;
+		uint32_t index = 0;
+	};
+
+private:
+	// Index of the first key greater than p_key, which is also the child to descend into.
+	_FORCE_INLINE_ static uint32_t _inner_upper_bound(const Inner *p_inner, const K &p_key) {
+		C less;
+		uint32_t lo = 0;
+		uint32_t hi = p_inner->count;
+		while (lo < hi) {
+			const uint32_t mid = (lo + hi) >> 1;
+			if (less(p_key, p_inner->keys()[mid])) {
+				hi = mid;
+			} else {
+				lo = mid + 1;
+			}
+		}
+		return lo;
+	}
+
+	_FORCE_INLINE_ static uint32_t _leaf_lower_bound(const Leaf *p_leaf, const K &p_key) {
+		C less;
+		uint32_t lo = 0;
+		uint32_t hi = p_leaf->count;
+		while (lo < hi) {
+			const uint32_t mid = (lo + hi) >> 1;
+			if (less(p_leaf->items()[mid].key, p_key)) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	_FORCE_INLINE_ static uint32_t _leaf_upper_bound(const Leaf *p_leaf, const K &p_key) {
+		C less;
+		uint32_t lo = 0;
+		uint32_t hi = p_leaf->count;
+		while (lo < hi) {
+			const uint32_t mid = (lo + hi) >> 1;
+			if (less(p_key, p_leaf->items()[mid].key)) {
+				hi = mid;
+			} else {
+				lo = mid + 1;
+			}
+		}
+		return lo;
+	}
+
+	Leaf *_find_leaf(const K &p_key) const {
+		Node *node = _root;
+		while (!node->leaf) {
+			Inner *inner = static_cast<Inner *>(node);
+			node = inner->children[_inner_upper_bound(inner, p_key)];
+		}
+		return static_cast<Leaf *>(node);
+	}
+
+	// Returns the leaf that should contain p_key, recording the path from the root to it.
+	Leaf *_find_leaf_path(const K &p_key, Inner **r_path, uint32_t *r_path_index, uint32_t &r_depth) const {
+		Node *node = _root;
+		r_depth = 0;
+		while (!node->leaf) {
+			Inner *inner = static_cast<Inner *>(node);
+			const uint32_t index = _inner_upper_bound(inner, p_key);
+			r_path[r_depth] = inner;
+			r_path_index[r_depth] = index;
+			r_depth++;
+			node = inner->children[index];
+		}
+		return static_cast<Leaf *>(node);
+	}
+
+	Iterator _lower_bound(const K &p_key) const {
+		if (!_root) {
+			return Iterator();
+		}
+		Leaf *leaf = _find_leaf(p_key);
+		const uint32_t index = _leaf_lower_bound(leaf, p_key);
+		if (index == leaf->count) {
+			return Iterator(leaf->next, 0);
+		}
+		return Iterator(leaf, index);
+	}
+
+	Iterator _upper_bound(const K &p_key) const {
+		if (!_root) {
+			return Iterator();
+		}
+		Leaf *leaf = _find_leaf(p_key);
+		const uint32_t index = _leaf_upper_bound(leaf, p_key);
+		if (index == leaf->count) {
+			return Iterator(leaf->next, 0);
+		}
+		return Iterator(leaf, index);
+	}
+
+	Iterator _find(const K &p_key) const {
+		if (!_root) {
+			return Iterator();
+		}
+		Leaf *leaf = _find_leaf(p_key);
+		const uint32_t index = _leaf_lower_bound(leaf, p_key);
+		if (index == leaf->count || C()(p_key, leaf->items()[index].key)) {
+			return Iterator();
+		}
+		return Iterator(leaf, index);
+	}
+
+	Iterator _find_closest(const K &p_key) const {
+		if (!_root) {
+			return Iterator();
+		}
+		Leaf *leaf = _find_leaf(p_key);
+		const uint32_t index = _leaf_upper_bound(leaf, p_key);
+		if (index > 0) {
+			return Iterator(leaf, index - 1);
+		}
+		// Lower than every key in this leaf, the closest one is the last of the previous leaf.
+		if (leaf->prev) {
+			return Iterator(leaf->prev, leaf->prev->count - 1);
+		}
+		return Iterator();
+	}
+
+	static void _leaf_insert(Leaf *p_leaf, uint32_t p_index, const K &p_key, const V &p_value) {
+		ValueType *items = p_leaf->items();
+		memmove((void *)&items[p_index + 1], (void *)&items[p_index], (p_leaf->count - p_index) * sizeof(ValueType));
+		memnew_placement(&items[p_index], ValueType(p_key, p_value));
+		p_leaf->count++;
+	}
+
+	static void _inner_insert(Inner *p_inner, uint32_t p_index, const K &p_key, Node *p_right) {
+		K *keys = p_inner->keys();
+		memmove((void *)&keys[p_index + 1], (void *)&keys[p_index], (p_inner->count - p_index) * sizeof(K));
+		memmove(&p_inner->children[p_index + 2], &p_inner->children[p_index + 1], (p_inner->count - p_index) * sizeof(Node *));
+		memnew_placement(&keys[p_index], K(p_key));
+		p_inner->children[p_index + 1] = p_right;
+		p_inner->count++;
+	}
+
+	// Removes keys[p_index] and children[p_index + 1].
+	static void _inner_remove(Inner *p_inner, uint32_t p_index) {
+		K *keys = p_inner->keys();
+		keys[p_index].~K();
+		memmove((void *)&keys[p_index], (void *)&keys[p_index + 1], (p_inner->count - p_index - 1) * sizeof(K));
+		memmove(&p_inner->children[p_index + 1], &p_inner->children[p_index + 2], (p_inner->count - p_index - 1) * sizeof(Node *));
+		p_inner->count--;
+	}
+
+	// Inserts p_right after the node that was split at the end of the path, splitting the parents as needed.
+	void _insert_split(Inner **p_path, uint32_t *p_path_index, uint32_t p_depth, K p_separator, Node *p_right) {
+		while (p_depth > 0) {
+			p_depth--;
+			Inner *inner = p_path[p_depth];
+			const uint32_t index = p_path_index[p_depth];
+			if (inner->count < INNER_CAPACITY) {
+				_inner_insert(inner, index, p_separator, p_right);
+				return;
+			}
+
+			// The middle key moves up, the ones after it go to the new node.
+			const uint32_t mid = INNER_CAPACITY / 2;
+			Inner *right = memnew_allocator(Inner, A);
+			K promoted = inner->keys()[mid];
+			inner->keys()[mid].~K();
+			right->count = INNER_CAPACITY - mid - 1;
+			memcpy((void *)right->keys(), (void *)&inner->keys()[mid + 1], right->count * sizeof(K));
+			memcpy(right->children, &inner->children[mid + 1], (right->count + 1) * sizeof(Node *));
+			inner->count = mid;
+
+			if (index <= mid) {
+				_inner_insert(inner, index, p_separator, p_right);
+			} else {
+				_inner_insert(right, index - mid - 1, p_separator, p_right);
+			}
+
+			p_separator = promoted;
+			p_right = right;
+		}
+
+		Inner *root = memnew_allocator(Inner, A);
+		memnew_placement(&root->keys()[0], K(p_separator));
+		root->children[0] = _root;
+		root->children[1] = p_right;
+		root->count = 1;
+		_root = root;
+	}
+
+	// Takes copies since the arguments can be elements of the map (e.g. `insert(k, map[other])`), which the insertion moves.
+	Iterator _insert(K p_key, V p_value, bool p_overwrite) {
+		if (!_root) {
+			Leaf *leaf = memnew_allocator(Leaf, A);
+			_leaf_insert(leaf, 0, p_key, p_value);
+			_root = leaf;
+			_first = leaf;
+			_last = leaf;
+			_size = 1;
+			return Iterator(leaf, 0);
+		}
+
+		Inner *path[MAX_DEPTH];
+		uint32_t path_index[MAX_DEPTH];
+		uint32_t depth;
+		Leaf *leaf = _find_leaf_path(p_key, path, path_index, depth);
+
+		const uint32_t index = _leaf_lower_bound(leaf, p_key);
+		if (index < leaf->count && !C()(p_key, leaf->items()[index].key)) {
+			if (p_overwrite) {
+				leaf->items()[index].value = p_value;
+			}
+			return Iterator(leaf, index);
+		}
+
+		_size++;
+		if (leaf->count < LEAF_CAPACITY) {
+			_leaf_insert(leaf, index, p_key, p_value);
+			return Iterator(leaf, index);
+		}
+
+		// Split the leaf in two halves, the new one goes after it.
+		const uint32_t mid = LEAF_CAPACITY / 2;
+		Leaf *right = memnew_allocator(Leaf, A);
+		right->count = LEAF_CAPACITY - mid;
+		memcpy((void *)right->items(), (void *)&leaf->items()[mid], right->count * sizeof(ValueType));
+		leaf->count = mid;
+
+		right->prev = leaf;
+		right->next = leaf->next;
+		if (leaf->next) {
+			leaf->next->prev = right;
+		} else {
+			_last = right;
+		}
+		leaf->next = right;
+
+		Iterator it;
+		if (index <= mid) {
+			_leaf_insert(leaf, index, p_key, p_value);
+			it = Iterator(leaf, index);
+		} else {
+			_leaf_insert(right, index - mid, p_key, p_value);
+			it = Iterator(right, index - mid);
+		}
+
+		_insert_split(path, path_index, depth, right->items()[0].key, right);
+		return it;
+	}
+
+	// Moves everything in children[p_index] to children[p_index - 1], then removes it.
+	void _merge_leaves(Inner *p_parent, uint32_t p_index) {
+		Leaf *left = static_cast<Leaf *>(p_parent->children[p_index - 1]);
+		Leaf *right = static_cast<Leaf *>(p_parent->children[p_index]);
+		memcpy((void *)&left->items()[left->count], (void *)right->items(), right->count * sizeof(ValueType));
+		left->count += right->count;
+
+		left->next = right->next;
+		if (right->next) {
+			right->next->prev = left;
+		} else {
+			_last = left;
+		}
+
+		memdelete_allocator<Leaf, A>(right);
+		_inner_remove(p_parent, p_index - 1);
+	}
+
+	void _merge_inners(Inner *p_parent, uint32_t p_index) {
+		Inner *left = static_cast<Inner *>(p_parent->children[p_index - 1]);
+		Inner *right = static_cast<Inner *>(p_parent->children[p_index]);
+		memnew_placement(&left->keys()[left->count], K(p_parent->keys()[p_index - 1]));
+		memcpy((void *)&left->keys()[left->count + 1], (void *)right->keys(), right->count * sizeof(K));
+		memcpy(&left->children[left->count + 1], right->children, (right->count + 1) * sizeof(Node *));
+		left->count += right->count + 1;
+
+		memdelete_allocator<Inner, A>(right);
+		_inner_remove(p_parent, p_index - 1);
+	}
+
+	// Refills the inner node at p_depth in the path if it has too few keys, then its parents.
+	void _rebalance_inner(Inner **p_path, uint32_t *p_path_index, uint32_t p_depth) {
+		while (true) {
+			Inner *inner = p_path[p_depth];
+			if (p_depth == 0) {
+				if (inner->count == 0) {
+					_root = inner->children[0];
+					memdelete_allocator<Inner, A>(inner);
+				}
+				return;
+			}
+			if (inner->count >= MIN_INNER_COUNT) {
+				return;
+			}
+
+			Inner *parent = p_path[p_depth - 1];
+			const uint32_t index = p_path_index[p_depth - 1];
+
+			if (index > 0) {
+				Inner *left = static_cast<Inner *>(parent->children[index - 1]);
+				if (left->count > MIN_INNER_COUNT) {
+					// Rotate the last child of the left sibling through the parent.
+					memmove((void *)&inner->keys()[1], (void *)inner->keys(), inner->count * sizeof(K));
+					memmove(&inner->children[1], inner->children, (inner->count + 1) * sizeof(Node *));
+					memnew_placement(&inner->keys()[0], K(parent->keys()[index - 1]));
+					inner->children[0] = left->children[left->count];
+					inner->count++;
+
+					parent->keys()[index - 1] = left->keys()[left->count - 1];
+					left->keys()[left->count - 1].~K();
+					left->count--;
+					return;
+				}
+			}
+			if (index < parent->count) {
+				Inner *right = static_cast<Inner *>(parent->children[index + 1]);
+				if (right->count > MIN_INNER_COUNT) {
+					memnew_placement(&inner->keys()[inner->count], K(parent->keys()[index]));
+					inner->children[inner->count + 1] = right->children[0];
+					inner->count++;
+
+					parent->keys()[index] = right->keys()[0];
+					right->keys()[0].~K();
+					memmove((void *)right->keys(), (void *)&right->keys()[1], (right->count - 1) * sizeof(K));
+					memmove(right->children, &right->children[1], right->count * sizeof(Node *));
+					right->count--;
+					return;
+				}
+			}
+
+			_merge_inners(parent, index > 0 ? index : index + 1);
+			p_depth--;
+		}
+	}
+
+	void _erase(Inner **p_path, uint32_t *p_path_index, uint32_t p_depth, Leaf *p_leaf, uint32_t p_index) {
+		ValueType *items = p_leaf->items();
+		items[p_index].~ValueType();
+		memmove((void *)&items[p_index], (void *)&items[p_index + 1], (p_leaf->count - p_index - 1) * sizeof(ValueType));
+		p_leaf->count--;
+		_size--;
+
+		if (p_depth == 0) {
+			if (p_leaf->count == 0) {
+				memdelete_allocator<Leaf, A>(p_leaf);
+				_root = nullptr;
+				_first = nullptr;
+				_last = nullptr;
+			}
+			return;
+		}
+		if (p_leaf->count >= MIN_LEAF_COUNT) {
+			return;
+		}
+
+		Inner *parent = p_path[p_depth - 1];
+		const uint32_t index = p_path_index[p_depth - 1];
+
+		if (index > 0) {
+			Leaf *left = static_cast<Leaf *>(parent->children[index - 1]);
+			if (left->count > MIN_LEAF_COUNT) {
+				memmove((void *)&items[1], (void *)items, p_leaf->count * sizeof(ValueType));
+				memcpy((void *)items, (void *)&left->items()[left->count - 1], sizeof(ValueType));
+				left->count--;
+				p_leaf->count++;
+				parent->keys()[index - 1] = items[0].key;
+				return;
+			}
+		}
+		if (index < parent->count) {
+			Leaf *right = static_cast<Leaf *>(parent->children[index + 1]);
+			if (right->count > MIN_LEAF_COUNT) {
+				memcpy((void *)&items[p_leaf->count], (void *)right->items(), sizeof(ValueType));
+				memmove((void *)right->items(), (void *)&right->items()[1], (right->count - 1) * sizeof(ValueType));
+				right->count--;
+				p_leaf->count++;
+				parent->keys()[index] = right->items()[0].key;
+				return;
+			}
+		}
+
+		_merge_leaves(parent, index > 0 ? index : index + 1);
+		_rebalance_inner(p_path, p_path_index, p_depth - 1);
+	}
+
+	void _free_node(Node *p_node) {
+		if (p_node->leaf) {
+			Leaf *leaf = static_cast<Leaf *>(p_node);
+			if constexpr (!std::is_trivially_destructible_v<K> || !std::is_trivially_destructible_v<V>) {
+				for (uint32_t i = 0; i < leaf->count; i++) {
+					leaf->items()[i].~ValueType();
+				}
+			}
+			memdelete_allocator<Leaf, A>(leaf);
+			return;
+		}
+
+		Inner *inner = static_cast<Inner *>(p_node);
+		for (uint32_t i = 0; i <= inner->count; i++) {
+			_free_node(inner->children[i]);
+		}
+		if constexpr (!std::is_trivially_destructible_v<K>) {
+			for (uint32_t i = 0; i < inner->count; i++) {
+				inner->keys()[i].~K();
+			}
+		}
+		memdelete_allocator<Inner, A>(inner);
+	}
+
+	// Copies the structure of another tree as is, leaves are linked in order as they are created.
+	Node *_clone_node(const Node *p_node) {
+		if (p_node->leaf) {
+			const Leaf *src = static_cast<const Leaf *>(p_node);
+			Leaf *leaf = memnew_allocator(Leaf, A);
+			for (uint32_t i = 0; i < src->count; i++) {
+				memnew_placement(&leaf->items()[i], ValueType(src->items()[i]));
+			}
+			leaf->count = src->count;
+
+			leaf->prev = _last;
+			if (_last) {
+				_last->next = leaf;
+			} else {
+				_first = leaf;
+			}
+			_last = leaf;
+			return leaf;
+		}
+
+		const Inner *src = static_cast<const Inner *>(p_node);
+		Inner *inner = memnew_allocator(Inner, A);
+		for (uint32_t i = 0; i < src->count; i++) {
+			memnew_placement(&inner->keys()[i], K(src->keys()[i]));
+		}
+		for (uint32_t i = 0; i <= src->count; i++) {
+			inner->children[i] = _clone_node(src->children[i]);
+		}
+		inner->count = src->count;
+		return inner;
+	}
+
+	void _copy_from(const BTreeMap &p_map) {
+		clear();
+		if (p_map._root) {
+			_root = _clone_node(p_map._root);
+			_size = p_map._size;
+		}
+	}
+
+public:
+	_FORCE_INLINE_ Iterator begin() {
+		return Iterator(_first, 0);
+	}
+	_FORCE_INLINE_ Iterator end() {
+		return Iterator();
+	}
+	_FORCE_INLINE_ ConstIterator begin() const {
+		return ConstIterator(_first, 0);
+	}
+	_FORCE_INLINE_ ConstIterator end() const {
+		return ConstIterator();
+	}
+
+	Iterator front() {
+		return Iterator(_first, 0);
+	}
+	ConstIterator front() const {
+		return ConstIterator(_first, 0);
+	}
+	Iterator back() {
+		return _last ? Iterator(_last, _last->count - 1) : Iterator();
+	}
+	ConstIterator back() const {
+		return _last ? ConstIterator(_last, _last->count - 1) : ConstIterator();
+	}
+
+	Iterator find(const K &p_key) {
+		return _find(p_key);
+	}
+	ConstIterator find(const K &p_key) const {
+		return _find(p_key);
+	}
+
+	// Element with the greatest key that is not greater than p_key, like RBMap::find_closest().
+	Iterator find_closest(const K &p_key) {
+		return _find_closest(p_key);
+	}
+	ConstIterator find_closest(const K &p_key) const {
+		return _find_closest(p_key);
+	}
+
+	// First element with a key that is not lower than p_key.
+	Iterator lower_bound(const K &p_key) {
+		return _lower_bound(p_key);
+	}
+	ConstIterator lower_bound(const K &p_key) const {
+		return _lower_bound(p_key);
+	}
+
+	// First element with a key greater than p_key.
+	Iterator upper_bound(const K &p_key) {
+		return _upper_bound(p_key);
+	}
+	ConstIterator upper_bound(const K &p_key) const {
+		return _upper_bound(p_key);
+	}
+
+	bool has(const K &p_key) const {
+		return bool(_find(p_key));
+	}
+
+	Iterator insert(const K &p_key, const V &p_value) {
+		return _insert(p_key, p_value, true);
+	}
+
+	bool erase(const K &p_key) {
+		if (!_root) {
+			return false;
+		}
+
+		Inner *path[MAX_DEPTH];
+		uint32_t path_index[MAX_DEPTH];
+		uint32_t depth;
+		Leaf *leaf = _find_leaf_path(p_key, path, path_index, depth);
+
+		const uint32_t index = _leaf_lower_bound(leaf, p_key);
+		if (index == leaf->count || C()(p_key, leaf->items()[index].key)) {
+			return false;
+		}
+
+		_erase(path, path_index, depth, leaf, index);
+		return true;
+	}
+
+	void remove(const Iterator &p_iter) {
+		ERR_FAIL_COND(!p_iter);
+		// The key is removed with the element, so it can't be passed by reference.
+		const K key = p_iter.key();
+		erase(key);
+	}
+
+	const V &operator[](const K &p_key) const {
+		ConstIterator e = find(p_key);
+		CRASH_COND(!e);
+		return e.value();
+	}
+
+	V &operator[](const K &p_key) {
+		return _insert(p_key, V(), false).value();
+	}
+
+	inline bool is_empty() const {
+		return _size == 0;
+	}
+	inline int size() const {
+		return _size;
+	}
+
+	int calculate_depth() const {
+		// used for debug mostly
+		int depth = 0;
+		for (const Node *node = _root; node; node = node->leaf ? nullptr : static_cast<const Inner *>(node)->children[0]) {
+			depth++;
+		}
+		return depth;
+	}
+
+	void clear() {
+		if (!_root) {
+			return;
+		}
+
+		_free_node(_root);
+		_root = nullptr;
+		_first = nullptr;
+		_last = nullptr;
+		_size = 0;
+	}
+
+	void operator=(const BTreeMap &p_map) {
+		if (this != &p_map) {
+			_copy_from(p_map);
+		}
+	}
+
+	BTreeMap(const BTreeMap &p_map) {
+		_copy_from(p_map);
+	}
+
+	_FORCE_INLINE_ BTreeMap() {}
+
+	~BTreeMap() {
+		clear();
+	}
+};
+
+} // namespace godot
+
+#endif // GODOT_B_TREE_MAP_HPP
@@ -0,0 +1,377 @@
+/**************************************************************************/
+/*  concurrent_hash_map.hpp                                               */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_CONCURRENT_HASH_MAP_HPP
+#define GODOT_CONCURRENT_HASH_MAP_HPP
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/templates/flat_hash_map.hpp>
+#include <godot_cpp/templates/spin_lock.hpp>
+
+#include <thread>
+
+namespace godot {
+
+/**
+ * A hash map that can be used from several threads at once, e.g. a cache
+ * shared by ThreadWorkPool workers.
+ *
+ * Keys are spread over SHARD_COUNT independent FlatHashMap shards, each one
+ * with its own lock and on its own cache line, so threads only contend when
+ * they access keys of the same shard.
+ *
+ * Values are returned by copy since another thread can erase or replace them
+ * at any time; use access() to work on a value in place. The functions passed
+ * to access() and for_each() run with the shard locked, they must be short and
+ * must not use the map.
+ */
+template <typename TKey, typename TValue,
+		typename Hasher = HashMapHasherDefault,
+		typename Comparator = HashMapComparatorDefault<TKey>,
+		uint32_t SHARD_COUNT = 64>
+class ConcurrentHashMap {
+	static_assert(SHARD_COUNT > 0 && (SHARD_COUNT & (SHARD_COUNT - 1)) == 0, "SHARD_COUNT must be a power of 2.");
+
+public:
+	struct Stats {
+		uint32_t size = 0;
+		uint64_t lookups = 0;
+		uint64_t hits = 0;
+		uint64_t inserts = 0;
+		uint64_t erases = 0;
+		uint64_t contentions = 0; // Times the shard lock was already held by another thread.
+	};
+
+private:
+	struct Slot {
+		TValue value;
+		bool ready = false; // False while get_or_insert() is creating the value.
+	};
+
+	typedef FlatHashMap<TKey, Slot, Hasher, Comparator> ShardMap;
+
+	struct alignas(64) Shard {
+		SpinLock lock;
+		ShardMap map;
+		Stats stats;
+
+		_FORCE_INLINE_ void acquire() {
+			if (unlikely(!lock.try_lock())) {
+				lock.lock();
+				stats.contentions++;
+			}
+		}
+	};
+
+	// Allocated with the alignment of the cache line, which memnew doesn't guarantee.
+	Shard *shards = nullptr;
+
+	_FORCE_INLINE_ Shard &_get_shard(const TKey &p_key) const {
+		// FlatHashMap hashes with hash_fmix32(), a multiplicative hash keeps the
+		// shard index independent from the slot position inside the shard.
+		const uint32_t hash = Hasher::hash(p_key) * 0x9E3779B1u;
+		return shards[(uint64_t(hash) * SHARD_COUNT) >> 32];
+	}
+
+public:
+	_FORCE_INLINE_ static constexpr uint32_t get_shard_count() { return SHARD_COUNT; }
+
+	// The result is only a snapshot while other threads insert or erase.
+	uint32_t size() const {
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < SHARD_COUNT; i++) {
+			shards[i].acquire();
+			count += shards[i].stats.size;
+			shards[i].lock.unlock();
+		}
+		return count;
+	}
+
+	bool is_empty() const {
+		return size() == 0;
+	}
+
+	bool has(const TKey &p_key) const {
+		Shard &shard = _get_shard(p_key);
+		shard.acquire();
+		const Slot *slot = shard.map.getptr(p_key);
+		const bool found = slot && slot->ready;
+		shard.stats.lookups++;
+		shard.stats.hits += found;
+		shard.lock.unlock();
+		return found;
+	}
+
+	// Copies the value to r_value and returns true if the key exists.
+	bool get(const TKey &p_key, TValue &r_value) const {
+		Shard &shard = _get_shard(p_key);
+		shard.acquire();
+		const Slot *slot = shard.map.getptr(p_key);
+		const bool found = slot && slot->ready;
+		if (found) {
+			r_value = slot->value;
+		}
+		shard.stats.lookups++;
+		shard.stats.hits += found;
+		shard.lock.unlock();
+		return found;
+	}
+
+	// Calls p_func(TValue &) with the value of the key, if it exists, and returns whether it was called.
+	template <typename F>
+	bool access(const TKey &p_key, F p_func) {
+		Shard &shard = _get_shard(p_key);
+		shard.acquire();
+		Slot *slot = shard.map.getptr(p_key);
+		const bool found = slot && slot->ready;
+		if (found) {
+			p_func(slot->value);
+		}
+		shard.stats.lookups++;
+		shard.stats.hits += found;
+		shard.lock.unlock();
+		return found;
+	}
+
+	// Inserts or replaces the value of the key. Returns true if the key was inserted.
+	bool insert(const TKey &p_key, const TValue &p_value) {
+		Shard &shard = _get_shard(p_key);
+		shard.acquire();
+		Slot *slot = shard.map.getptr(p_key);
+		const bool inserted = !slot || !slot->ready;
+		if (slot) {
+			// Also publishes a value still being created by get_or_insert(),
+			// whose result is then discarded.
+			slot->value = p_value;
+			slot->ready = true;
+		} else {
+			shard.map.insert(p_key, Slot{ p_value, true });
+		}
+		if (inserted) {
+			shard.stats.size++;
+			shard.stats.inserts++;
+		}
+		shard.lock.unlock();
+		return inserted;
+	}
+
+	// Inserts the value only if the key doesn't exist. Returns true if it was inserted.
+	bool insert_if_absent(const TKey &p_key, const TValue &p_value) {
+		Shard &shard = _get_shard(p_key);
+		shard.acquire();
+		const bool inserted = !shard.map.has(p_key);
+		if (inserted) {
+			shard.map.insert(p_key, Slot{ p_value, true });
+			shard.stats.size++;
+			shard.stats.inserts++;
+		}
+		shard.lock.unlock();
+		return inserted;
+	}
+
+	// Returns the value of the key, creating it with p_factory() if it doesn't exist.
+	//
+	// The factory runs without holding the shard lock, so it can be slow (e.g.
+	// loading a resource). It's called at most once per key: other threads
+	// asking for the same key meanwhile wait for its result, while other keys
+	// stay available. A key being created is not visible to the other functions.
+	//
+	// p_factory must not call get_or_insert() for the same key, it would wait
+	// for its own result forever.
+	template <typename F>
+	TValue get_or_insert(const TKey &p_key, F p_factory) {
+		Shard &shard = _get_shard(p_key);
+		bool counted = false;
+		while (true) {
+			shard.acquire();
+			if (!counted) {
+				shard.stats.lookups++;
+			}
+			Slot *slot = shard.map.getptr(p_key);
+			if (!slot) {
+				break;
+			}
+			if (slot->ready) {
+				if (!counted) {
+					shard.stats.hits++;
+				}
+				TValue value = slot->value;
+				shard.lock.unlock();
+				return value;
+			}
+			// Another thread is creating the value.
+			counted = true;
+			shard.lock.unlock();
+			std::this_thread::yield();
+		}
+
+		shard.map.insert(p_key, Slot());
+		shard.lock.unlock();
+
+		TValue value = p_factory();
+
+		shard.acquire();
+		// Neither erase() nor clear() remove a key being created.
+		Slot *slot = shard.map.getptr(p_key);
+		if (slot->ready) {
+			// Replaced by insert() meanwhile, which takes precedence.
+			value = slot->value;
+		} else {
+			slot->value = value;
+			slot->ready = true;
+			shard.stats.size++;
+			shard.stats.inserts++;
+		}
+		shard.lock.unlock();
+		return value;
+	}
+
+	// Returns true if the key existed. Keys still being created by get_or_insert() are not erased.
+	bool erase(const TKey &p_key) {
+		Shard &shard = _get_shard(p_key);
+		shard.acquire();
+		const Slot *slot = shard.map.getptr(p_key);
+		const bool erased = slot && slot->ready;
+		if (erased) {
+			shard.map.erase(p_key);
+			shard.stats.size--;
+			shard.stats.erases++;
+		}
+		shard.lock.unlock();
+		return erased;
+	}
+
+	// Calls p_func(const TKey &, TValue &) for every element, locking one shard at a time.
+	template <typename F>
+	void for_each(F p_func) {
+		for (uint32_t i = 0; i < SHARD_COUNT; i++) {
+			Shard &shard = shards[i];
+			shard.acquire();
+			for (KeyValue<TKey, Slot> &E : shard.map) {
+				if (E.value.ready) {
+					p_func(E.key, E.value.value);
+				}
+			}
+			shard.lock.unlock();
+		}
+	}
+
+	// Keys still being created by get_or_insert() are not erased.
+	void clear() {
+		for (uint32_t i = 0; i < SHARD_COUNT; i++) {
+			Shard &shard = shards[i];
+			shard.acquire();
+			if (shard.map.size() == shard.stats.size) {
+				shard.map.clear(); // Nothing is being created.
+			} else {
+				// Erasing doesn't move the other elements, so iteration can go on.
+				typename ShardMap::Iterator it = shard.map.begin();
+				while (it) {
+					typename ShardMap::Iterator next = it;
+					++next;
+					if (it->value.ready) {
+						shard.map.remove(it);
+					}
+					it = next;
+				}
+			}
+			shard.stats.size = 0;
+			shard.lock.unlock();
+		}
+	}
+
+	// Reserves space for a number of elements, spread evenly over the shards.
+	void reserve(uint32_t p_new_capacity) {
+		const uint32_t per_shard = (p_new_capacity + SHARD_COUNT - 1) / SHARD_COUNT;
+		for (uint32_t i = 0; i < SHARD_COUNT; i++) {
+			Shard &shard = shards[i];
+			shard.acquire();
+			shard.map.reserve(per_shard + per_shard / 4);
+			shard.lock.unlock();
+		}
+	}
+
+	/** Statistics **/
+
+	Stats get_shard_stats(uint32_t p_shard) const {
+		ERR_FAIL_UNSIGNED_INDEX_V(p_shard, SHARD_COUNT, Stats());
+		Shard &shard = shards[p_shard];
+		shard.acquire();
+		Stats stats = shard.stats;
+		shard.lock.unlock();
+		return stats;
+	}
+
+	// Sum of the statistics of all the shards.
+	Stats get_stats() const {
+		Stats total;
+		for (uint32_t i = 0; i < SHARD_COUNT; i++) {
+			const Stats stats = get_shard_stats(i);
+			total.size += stats.size;
+			total.lookups += stats.lookups;
+			total.hits += stats.hits;
+			total.inserts += stats.inserts;
+			total.erases += stats.erases;
+			total.contentions += stats.contentions;
+		}
+		return total;
+	}
+
+	void reset_stats() {
+		for (uint32_t i = 0; i < SHARD_COUNT; i++) {
+			Shard &shard = shards[i];
+			shard.acquire();
+			const uint32_t size = shard.stats.size;
+			shard.stats = Stats();
+			shard.stats.size = size;
+			shard.lock.unlock();
+		}
+	}
+
+	ConcurrentHashMap() {
+		shards = (Shard *)Memory::alloc_aligned_static(sizeof(Shard) * SHARD_COUNT, alignof(Shard), _MEM_CALL_SITE);
+		CRASH_COND_MSG(!shards, "Out of memory");
+		for (uint32_t i = 0; i < SHARD_COUNT; i++) {
+			memnew_placement(&shards[i], Shard);
+		}
+	}
+	~ConcurrentHashMap() {
+		for (uint32_t i = 0; i < SHARD_COUNT; i++) {
+			shards[i].~Shard();
+		}
+		Memory::free_aligned_static(shards);
+	}
+	ConcurrentHashMap(const ConcurrentHashMap &) = delete;
+	void operator=(const ConcurrentHashMap &) = delete;
+};
+
+} // namespace godot
+
+#endif // GODOT_CONCURRENT_HASH_MAP_HPP
@@ -0,0 +1,493 @@
+/**************************************************************************/
+/*  coroutine.hpp                                                         */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_COROUTINE_HPP
+#define GODOT_COROUTINE_HPP
+
+// Coroutines need C++20, the rest of godot-cpp only needs C++17, so this is
+// empty unless the file including it is built as C++20.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/memory.hpp>
+#include <godot_cpp/core/object.hpp>
+#include <godot_cpp/variant/callable_custom.hpp>
+#include <godot_cpp/variant/callable_method_pointer.hpp>
+#include <godot_cpp/variant/variant.hpp>
+
+#include <atomic>
+#include <coroutine>
+#include <type_traits>
+#include <utility>
+
+namespace godot {
+
+template <typename T>
+class Task;
+
+// Shared by the promises of every Task: when the coroutine ends, it resumes
+// the coroutine awaiting it, if any, or frees itself if it was started with
+// Task::start().
+class _TaskPromiseBase {
+	template <typename T>
+	friend class Task;
+
+	std::coroutine_handle<> continuation;
+	bool detached = false;
+
+	struct FinalAwaiter {
+		bool await_ready() noexcept { return false; }
+		template <typename P>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<P> p_handle) noexcept {
+			_TaskPromiseBase &promise = p_handle.promise();
+			if (promise.continuation) {
+				return promise.continuation;
+			}
+			if (promise.detached) {
+				p_handle.destroy();
+			}
+			return std::noop_coroutine();
+		}
+		void await_resume() noexcept {}
+	};
+
+public:
+	std::suspend_always initial_suspend() noexcept { return {}; }
+	FinalAwaiter final_suspend() noexcept { return {}; }
+	void unhandled_exception() { CRASH_NOW_MSG("Unhandled exception in a coroutine."); }
+};
+
+template <typename T>
+class _TaskPromise : public _TaskPromiseBase {
+	alignas(T) uint8_t result[sizeof(T)];
+	bool has_result = false;
+
+public:
+	Task<T> get_return_object();
+
+	template <typename V>
+	void return_value(V &&p_value) {
+		memnew_placement(result, T(std::forward<V>(p_value)));
+		has_result = true;
+	}
+
+	T take_result() {
+		CRASH_COND_MSG(!has_result, "The coroutine didn't return a value.");
+		return std::move(*(T *)result);
+	}
+
+	~_TaskPromise() {
+		if (has_result) {
+			((T *)result)->~T();
+		}
+	}
+};
+
+template <>
+class _TaskPromise<void> : public _TaskPromiseBase {
+public:
+	Task<void> get_return_object();
+	void return_void() {}
+	void take_result() {}
+};
+
+// Return type of a coroutine producing a T, e.g.
+//
+//   Task<Ref<Image>> load_image(String p_path) {
+//       PackedByteArray data = co_await run_on_worker_thread_pool([&]() { return read_file(p_path); });
+//       // Back on the main thread.
+//       co_return decode(data);
+//   }
+//
+// The coroutine doesn't run until the task is awaited by another coroutine,
+// which resumes when it ends, or until start() is called, which runs it in the
+// background and frees it when it ends. A Task destroyed before it ends
+// destroys the coroutine.
+template <typename T = void>
+class Task {
+public:
+	typedef _TaskPromise<T> promise_type;
+
+private:
+	std::coroutine_handle<promise_type> handle;
+
+	friend class _TaskPromise<T>;
+	explicit Task(std::coroutine_handle<promise_type> p_handle) :
+			handle(p_handle) {}
+
+public:
+	// Awaiting runs the task until it suspends, and resumes the caller when it ends.
+	bool await_ready() const { return !handle || handle.done(); }
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> p_awaiting) {
+		handle.promise().continuation = p_awaiting;
+		return handle;
+	}
+	T await_resume() {
+		CRASH_COND_MSG(!handle, "Awaiting an empty Task.");
+		return handle.promise().take_result();
+	}
+
+	// Runs the coroutine until it first suspends, then lets it finish on its own.
+	// The Task is empty afterwards.
+	void start() {
+		ERR_FAIL_COND_MSG(!handle, "Starting an empty Task.");
+		std::coroutine_handle<promise_type> coroutine = handle;
+		handle = nullptr;
+		coroutine.promise().detached = true;
+		coroutine.resume();
+	}
+
+	bool is_valid() const { return bool(handle); }
+	bool is_done() const { return handle && handle.done(); }
+
+	Task() {}
+	Task(Task &&p_other) :
+			handle(p_other.handle) {
+		p_other.handle = nullptr;
+	}
+	Task &operator=(Task &&p_other) {
+		if (this != &p_other) {
+			if (handle) {
+				handle.destroy();
+			}
+			handle = p_other.handle;
+			p_other.handle = nullptr;
+		}
+		return *this;
+	}
+	Task(const Task &) = delete;
+	void operator=(const Task &) = delete;
+
+	~Task() {
+		if (handle) {
+			handle.destroy();
+		}
+	}
+};
+
+template <typename T>
+Task<T> _TaskPromise<T>::get_return_object() {
+	return Task<T>(std::coroutine_handle<_TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> _TaskPromise<void>::get_return_object() {
+	return Task<void>(std::coroutine_handle<_TaskPromise<void>>::from_promise(*this));
+}
+
+// Coroutines waiting to be resumed on the main thread. The nodes are the
+// awaiters themselves, which live in the suspended coroutine frames, so
+// queuing doesn't allocate. A deferred call resumes them all, and is only
+// scheduled when the queue was empty.
+class _MainThreadQueue {
+public:
+	struct Node {
+		Node *next = nullptr;
+		std::coroutine_handle<> handle;
+	};
+
+private:
+	inline static std::atomic<Node *> head{ nullptr };
+
+	static void _flush() {
+		Node *node = head.exchange(nullptr, std::memory_order_acquire);
+		// The stack is newest first, resume in queuing order.
+		Node *ordered = nullptr;
+		while (node) {
+			Node *next = node->next;
+			node->next = ordered;
+			ordered = node;
+			node = next;
+		}
+		while (ordered) {
+			// Resuming can end the coroutine and free the node.
+			Node *next = ordered->next;
+			ordered->handle.resume();
+			ordered = next;
+		}
+	}
+
+public:
+	// Can be called from any thread.
+	static void push(Node *p_node) {
+		Node *old_head = head.load(std::memory_order_relaxed);
+		do {
+			p_node->next = old_head;
+		} while (!head.compare_exchange_weak(old_head, p_node, std::memory_order_release, std::memory_order_relaxed));
+		if (old_head == nullptr) {
+			callable_mp_static(&_MainThreadQueue::_flush).call_deferred();
+		}
+	}
+};
+
+// co_await resume_on_main_thread() continues the coroutine on the main thread,
+// during the next flush of deferred calls.
+class MainThreadAwaiter : public _MainThreadQueue::Node {
+public:
+	bool await_ready() const { return false; }
+	void await_suspend(std::coroutine_handle<> p_handle) {
+		handle = p_handle;
+		_MainThreadQueue::push(this);
+	}
+	void await_resume() {}
+};
+
+inline MainThreadAwaiter resume_on_main_thread() {
+	return MainThreadAwaiter();
+}
+
+// Runs a function as a WorkerThreadPool native task and resumes the awaiting
+// coroutine on the main thread with its result. The function is stored in the
+// awaiter, inside the coroutine frame, so nothing is allocated for it. The
+// coroutine must not be destroyed while it waits.
+template <typename F>
+class WorkerTaskAwaiter : public _MainThreadQueue::Node {
+	typedef std::invoke_result_t<F &> R;
+	static constexpr bool HAS_RESULT = !std::is_void_v<R>;
+	typedef std::conditional_t<HAS_RESULT, R, uint8_t> ResultStorage;
+
+	F function;
+	bool high_priority = false;
+	WorkerThreadPool::TaskID task_id = WorkerThreadPool::INVALID_TASK_ID;
+	// The task ending, and the awaiting thread storing task_id.
+	std::atomic<uint32_t> pending_releases{ 2 };
+	alignas(ResultStorage) uint8_t result[sizeof(ResultStorage)];
+
+	void _release() {
+		if (pending_releases.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			_MainThreadQueue::push(this);
+		}
+	}
+
+	static void _task_callback(void *p_self) {
+		WorkerTaskAwaiter *self = static_cast<WorkerTaskAwaiter *>(p_self);
+		if constexpr (HAS_RESULT) {
+			memnew_placement(self->result, R(self->function()));
+		} else {
+			self->function();
+		}
+		self->_release();
+	}
+
+public:
+	bool await_ready() const { return false; }
+	void await_suspend(std::coroutine_handle<> p_handle) {
+		handle = p_handle;
+		task_id = WorkerThreadPool::get_singleton()->add_native_task(&WorkerTaskAwaiter::_task_callback, this, high_priority);
+		_release();
+	}
+	R await_resume() {
+		// Already done, this only lets the pool release the task.
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(task_id);
+		if constexpr (HAS_RESULT) {
+			R *value = (R *)result;
+			R ret = std::move(*value);
+			value->~R();
+			return ret;
+		}
+	}
+
+	WorkerTaskAwaiter(F &&p_function, bool p_high_priority) :
+			function(std::move(p_function)), high_priority(p_high_priority) {}
+	WorkerTaskAwaiter(const WorkerTaskAwaiter &) = delete;
+	void operator=(const WorkerTaskAwaiter &) = delete;
+};
+
+// Same for WorkerThreadPool group tasks, p_function(index) runs for every
+// index in [0, p_elements) on up to p_tasks threads.
+template <typename F>
+class WorkerGroupTaskAwaiter : public _MainThreadQueue::Node {
+	F function;
+	int elements = 0;
+	int tasks = -1;
+	bool high_priority = false;
+	WorkerThreadPool::GroupID group_id = WorkerThreadPool::INVALID_TASK_ID;
+	std::atomic<int> pending_elements{ 0 };
+	std::atomic<uint32_t> pending_releases{ 2 };
+
+	void _release() {
+		if (pending_releases.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			_MainThreadQueue::push(this);
+		}
+	}
+
+	static void _group_callback(void *p_self, uint32_t p_index) {
+		WorkerGroupTaskAwaiter *self = static_cast<WorkerGroupTaskAwaiter *>(p_self);
+		self->function(p_index);
+		if (self->pending_elements.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			self->_release();
+		}
+	}
+
+public:
+	bool await_ready() const { return elements <= 0; }
+	void await_suspend(std::coroutine_handle<> p_handle) {
+		handle = p_handle;
+		pending_elements.store(elements, std::memory_order_relaxed);
+		group_id = WorkerThreadPool::get_singleton()->add_native_group_task(&WorkerGroupTaskAwaiter::_group_callback, this, elements, tasks, high_priority);
+		_release();
+	}
+	void await_resume() {
+		if (group_id != WorkerThreadPool::INVALID_TASK_ID) {
+			WorkerThreadPool::get_singleton()->wait_for_group_task_completion(group_id);
+		}
+	}
+
+	WorkerGroupTaskAwaiter(int p_elements, F &&p_function, int p_tasks, bool p_high_priority) :
+			function(std::move(p_function)), elements(p_elements), tasks(p_tasks), high_priority(p_high_priority) {}
+	WorkerGroupTaskAwaiter(const WorkerGroupTaskAwaiter &) = delete;
+	void operator=(const WorkerGroupTaskAwaiter &) = delete;
+};
+
+template <typename F>
+WorkerTaskAwaiter<std::decay_t<F>> run_on_worker_thread_pool(F &&p_function, bool p_high_priority = false) {
+	return WorkerTaskAwaiter<std::decay_t<F>>(std::decay_t<F>(std::forward<F>(p_function)), p_high_priority);
+}
+
+template <typename F>
+WorkerGroupTaskAwaiter<std::decay_t<F>> run_group_on_worker_thread_pool(int p_elements, F &&p_function, int p_tasks = -1, bool p_high_priority = false) {
+	return WorkerGroupTaskAwaiter<std::decay_t<F>>(p_elements, std::decay_t<F>(std::forward<F>(p_function)), p_tasks, p_high_priority);
+}
+
+class SignalAwaiter;
+
+// One shot connection resuming a SignalAwaiter. Callables made for the same
+// awaiter compare equal, so the awaiter can disconnect without holding a
+// reference, which would keep the connection alive after the object is freed.
+class _SignalAwaiterCallable : public CallableCustom {
+	friend class SignalAwaiter;
+
+	const SignalAwaiter *key = nullptr;
+	SignalAwaiter *awaiter = nullptr; // Null once it can't resume anymore.
+	ObjectID object_id;
+
+	static bool _compare_equal(const CallableCustom *p_a, const CallableCustom *p_b) {
+		return static_cast<const _SignalAwaiterCallable *>(p_a)->key == static_cast<const _SignalAwaiterCallable *>(p_b)->key;
+	}
+	static bool _compare_less(const CallableCustom *p_a, const CallableCustom *p_b) {
+		return static_cast<const _SignalAwaiterCallable *>(p_a)->key < static_cast<const _SignalAwaiterCallable *>(p_b)->key;
+	}
+
+public:
+	virtual uint32_t hash() const override { return uint32_t(uint64_t(key) >> 4); }
+	virtual String get_as_text() const override { return "SignalAwaiter"; }
+	virtual CompareEqualFunc get_compare_equal_func() const override { return &_SignalAwaiterCallable::_compare_equal; }
+	virtual CompareLessFunc get_compare_less_func() const override { return &_SignalAwaiterCallable::_compare_less; }
+	virtual ObjectID get_object() const override { return object_id; }
+	virtual void call(const Variant **p_arguments, int p_argcount, Variant &r_return_value, GDExtensionCallError &r_call_error) const override;
+
+	_SignalAwaiterCallable(const SignalAwaiter *p_key, SignalAwaiter *p_awaiter, ObjectID p_object_id) :
+			key(p_key), awaiter(p_awaiter), object_id(p_object_id) {}
+	virtual ~_SignalAwaiterCallable() override;
+};
+
+// `Array arguments = co_await some_signal;` resumes the coroutine when the
+// signal is emitted, on the emitting thread, with the signal arguments. If the
+// object is freed first, the coroutine is resumed on the main thread with an
+// empty Array.
+class SignalAwaiter : public _MainThreadQueue::Node {
+	friend class _SignalAwaiterCallable;
+
+	Signal signal;
+	_SignalAwaiterCallable *callable_custom = nullptr; // While connected.
+	Array arguments;
+
+public:
+	bool await_ready() const { return false; }
+	bool await_suspend(std::coroutine_handle<> p_handle) {
+		handle = p_handle;
+		Object *object = signal.get_object();
+		ERR_FAIL_NULL_V_MSG(object, false, "Awaiting a signal of a null object.");
+		callable_custom = memnew(_SignalAwaiterCallable(this, this, ObjectID(object->get_instance_id())));
+		Callable callable(callable_custom);
+		if (object->connect(signal.get_name(), callable, Object::CONNECT_ONE_SHOT) != OK) {
+			callable_custom->awaiter = nullptr;
+			callable_custom = nullptr;
+			return false;
+		}
+		return true;
+	}
+	Array await_resume() { return arguments; }
+
+	explicit SignalAwaiter(const Signal &p_signal) :
+			signal(p_signal) {}
+	SignalAwaiter(const SignalAwaiter &) = delete;
+	void operator=(const SignalAwaiter &) = delete;
+
+	// Only while suspended if the coroutine is destroyed before the signal comes.
+	~SignalAwaiter() {
+		if (callable_custom) {
+			callable_custom->awaiter = nullptr;
+			Object *object = ObjectDB::get_instance(callable_custom->object_id);
+			if (object) {
+				Callable callable(memnew(_SignalAwaiterCallable(this, nullptr, callable_custom->object_id)));
+				if (object->is_connected(signal.get_name(), callable)) {
+					object->disconnect(signal.get_name(), callable);
+				}
+			}
+		}
+	}
+};
+
+inline void _SignalAwaiterCallable::call(const Variant **p_arguments, int p_argcount, Variant &r_return_value, GDExtensionCallError &r_call_error) const {
+	r_call_error.error = GDEXTENSION_CALL_OK;
+	SignalAwaiter *target = awaiter;
+	if (!target) {
+		return;
+	}
+	const_cast<_SignalAwaiterCallable *>(this)->awaiter = nullptr;
+	target->callable_custom = nullptr;
+	for (int i = 0; i < p_argcount; i++) {
+		target->arguments.push_back(*p_arguments[i]);
+	}
+	target->handle.resume();
+}
+
+inline _SignalAwaiterCallable::~_SignalAwaiterCallable() {
+	if (awaiter) {
+		// Disconnected without being called, the object was freed.
+		awaiter->callable_custom = nullptr;
+		_MainThreadQueue::push(awaiter);
+	}
+}
+
+inline SignalAwaiter operator co_await(const Signal &p_signal) {
+	return SignalAwaiter(p_signal);
+}
+
+inline SignalAwaiter wait_for_signal(Object *p_object, const StringName &p_signal) {
+	return SignalAwaiter(Signal(p_object, p_signal));
+}
+
+} // namespace godot
+
+#endif // __cpp_impl_coroutine
+
+#endif // GODOT_COROUTINE_HPP
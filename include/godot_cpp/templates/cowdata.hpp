@@ -40,12 +40,16 @@
 #include <cstring>
 #include <new>
 #include <type_traits>
+#include <utility>
 
 namespace godot {
 
-template <typename T>
+template <typename T, size_t alignment>
 class Vector;
 
+template <typename T, size_t alignment>
+class UniqueVector;
+
 template <typename T, typename V>
 class VMap;
 
@@ -60,11 +64,16 @@ static_assert(std::is_trivially_destructible_v<std::atomic<uint64_t>>);
 #pragma GCC diagnostic ignored "-Wplacement-new"
 #endif
 
-template <typename T>
+template <typename T, size_t alignment = alignof(max_align_t)>
 class CowData {
-	template <typename TV>
+	static_assert((alignment & (alignment - 1)) == 0, "Alignment must be a power of 2.");
+
+	template <typename TV, size_t AV>
 	friend class Vector;
 
+	template <typename TU, size_t AU>
+	friend class UniqueVector;
+
 	template <typename TV, typename VV>
 	friend class VMap;
 
@@ -96,25 +105,56 @@ private:
 		return ++x;
 	}
 
-	// Alignment:  ↓ max_align_t           ↓ USize          ↓ max_align_t
-	//             ┌────────────────────┬──┬─────────────┬──┬───────────...
-	//             │ SafeNumeric<USize> │░░│ USize       │░░│ T[]
-	//             │ ref. count         │░░│ data size   │░░│ data
-	//             └────────────────────┴──┴─────────────┴──┴───────────...
-	// Offset:     ↑ REF_COUNT_OFFSET      ↑ SIZE_OFFSET    ↑ DATA_OFFSET
+	// Alignment:  ↓ max_align_t           ↓ USize             ↓ USize          ↓ max_align_t
+	//             ┌────────────────────┬──┬─────────────────┬──┬─────────────┬──┬───────────...
+	//             │ SafeNumeric<USize> │░░│ USize           │░░│ USize       │░░│ T[]
+	//             │ ref. count         │░░│ capacity        │░░│ data size   │░░│ data
+	//             └────────────────────┴──┴─────────────────┴──┴─────────────┴──┴───────────...
+	// Offset:     ↑ REF_COUNT_OFFSET      ↑ CAPACITY_OFFSET      ↑ SIZE_OFFSET    ↑ DATA_OFFSET
+	// When `alignment` is larger than max_align_t, the block and DATA_OFFSET are aligned to it instead.
 
 	static constexpr size_t REF_COUNT_OFFSET = 0;
-	static constexpr size_t SIZE_OFFSET = ((REF_COUNT_OFFSET + sizeof(SafeNumeric<USize>)) % alignof(USize) == 0) ? (REF_COUNT_OFFSET + sizeof(SafeNumeric<USize>)) : ((REF_COUNT_OFFSET + sizeof(SafeNumeric<USize>)) + alignof(USize) - ((REF_COUNT_OFFSET + sizeof(SafeNumeric<USize>)) % alignof(USize)));
-	static constexpr size_t DATA_OFFSET = ((SIZE_OFFSET + sizeof(USize)) % alignof(max_align_t) == 0) ? (SIZE_OFFSET + sizeof(USize)) : ((SIZE_OFFSET + sizeof(USize)) + alignof(max_align_t) - ((SIZE_OFFSET + sizeof(USize)) % alignof(max_align_t)));
+	static constexpr size_t CAPACITY_OFFSET = ((REF_COUNT_OFFSET + sizeof(SafeNumeric<USize>)) % alignof(USize) == 0) ? (REF_COUNT_OFFSET + sizeof(SafeNumeric<USize>)) : ((REF_COUNT_OFFSET + sizeof(SafeNumeric<USize>)) + alignof(USize) - ((REF_COUNT_OFFSET + sizeof(SafeNumeric<USize>)) % alignof(USize)));
+	static constexpr size_t SIZE_OFFSET = ((CAPACITY_OFFSET + sizeof(USize)) % alignof(USize) == 0) ? (CAPACITY_OFFSET + sizeof(USize)) : ((CAPACITY_OFFSET + sizeof(USize)) + alignof(USize) - ((CAPACITY_OFFSET + sizeof(USize)) % alignof(USize)));
+	static constexpr size_t DATA_ALIGNMENT = alignment > alignof(max_align_t) ? alignment : alignof(max_align_t);
+	static constexpr size_t DATA_OFFSET = ((SIZE_OFFSET + sizeof(USize)) % DATA_ALIGNMENT == 0) ? (SIZE_OFFSET + sizeof(USize)) : ((SIZE_OFFSET + sizeof(USize)) + DATA_ALIGNMENT - ((SIZE_OFFSET + sizeof(USize)) % DATA_ALIGNMENT));
 
 	mutable T *_ptr = nullptr;
 
 	// internal helpers
 
+	static _FORCE_INLINE_ uint8_t *_alloc(USize p_bytes) {
+		if constexpr (alignment > alignof(max_align_t)) {
+			return (uint8_t *)Memory::alloc_aligned_static(p_bytes, alignment);
+		} else {
+			return (uint8_t *)Memory::alloc_static(p_bytes, false);
+		}
+	}
+
+	static _FORCE_INLINE_ uint8_t *_realloc(uint8_t *p_mem, USize p_bytes, USize p_prev_bytes) {
+		if constexpr (alignment > alignof(max_align_t)) {
+			return (uint8_t *)Memory::realloc_aligned_static(p_mem, p_bytes, p_prev_bytes, alignment);
+		} else {
+			return (uint8_t *)Memory::realloc_static(p_mem, p_bytes, false);
+		}
+	}
+
+	static _FORCE_INLINE_ void _free(uint8_t *p_mem) {
+		if constexpr (alignment > alignof(max_align_t)) {
+			Memory::free_aligned_static(p_mem);
+		} else {
+			Memory::free_static(p_mem, false);
+		}
+	}
+
 	static _FORCE_INLINE_ SafeNumeric<USize> *_get_refcount_ptr(uint8_t *p_ptr) {
 		return (SafeNumeric<USize> *)(p_ptr + REF_COUNT_OFFSET);
 	}
 
+	static _FORCE_INLINE_ USize *_get_capacity_ptr(uint8_t *p_ptr) {
+		return (USize *)(p_ptr + CAPACITY_OFFSET);
+	}
+
 	static _FORCE_INLINE_ USize *_get_size_ptr(uint8_t *p_ptr) {
 		return (USize *)(p_ptr + SIZE_OFFSET);
 	}
@@ -139,6 +179,14 @@ private:
 		return (USize *)((uint8_t *)_ptr - DATA_OFFSET + SIZE_OFFSET);
 	}
 
+	_FORCE_INLINE_ USize *_get_capacity() const {
+		if (!_ptr) {
+			return nullptr;
+		}
+
+		return (USize *)((uint8_t *)_ptr - DATA_OFFSET + CAPACITY_OFFSET);
+	}
+
 	_FORCE_INLINE_ USize _get_alloc_size(USize p_elements) const {
 		return next_po2(p_elements * sizeof(T));
 	}
@@ -168,12 +216,15 @@ private:
 	}
 
 	void _unref(void *p_data);
+	void _free_data(void *p_data);
 	void _ref(const CowData *p_from);
 	void _ref(const CowData &p_from);
-	USize _copy_on_write();
+	USize _copy_on_write(USize p_min_capacity = 0);
+	Error _set_capacity(USize p_capacity, USize p_refcount);
+	Error _insert_space(Size p_pos, Size p_count);
 
 public:
-	void operator=(const CowData<T> &p_from) { _ref(p_from); }
+	void operator=(const CowData &p_from) { _ref(p_from); }
 
 	_FORCE_INLINE_ T *ptrw() {
 		_copy_on_write();
@@ -193,8 +244,18 @@ public:
 		}
 	}
 
+	// Amount of elements that fit in the current allocation.
+	_FORCE_INLINE_ Size get_capacity() const {
+		USize *capacity = _get_capacity();
+		if (capacity) {
+			return *capacity;
+		} else {
+			return 0;
+		}
+	}
+
 	_FORCE_INLINE_ void clear() { resize(0); }
-	_FORCE_INLINE_ bool is_empty() const { return _ptr == nullptr; }
+	_FORCE_INLINE_ bool is_empty() const { return size() == 0; }
 
 	_FORCE_INLINE_ void set(Size p_index, const T &p_elem) {
 		ERR_FAIL_INDEX(p_index, size());
@@ -217,39 +278,37 @@ public:
 	template <bool p_ensure_zero = false>
 	Error resize(Size p_size);
 
+	Error reserve(Size p_capacity);
+	Error shrink_to_fit();
+
 	_FORCE_INLINE_ void remove_at(Size p_index) {
 		ERR_FAIL_INDEX(p_index, size());
-		T *p = ptrw();
-		Size len = size();
-		for (Size i = p_index; i < len - 1; i++) {
-			p[i] = p[i + 1];
-		}
-
-		resize(len - 1);
+		remove_range(p_index, 1);
 	}
 
 	Error insert(Size p_pos, const T &p_val) {
 		ERR_FAIL_INDEX_V(p_pos, size() + 1, ERR_INVALID_PARAMETER);
-		resize(size() + 1);
-		for (Size i = (size() - 1); i > p_pos; i--) {
-			set(i, get(i - 1));
-		}
-		set(p_pos, p_val);
+		Error err = _insert_space(p_pos, 1);
+		ERR_FAIL_COND_V(err, err);
+		_ptr[p_pos] = p_val;
 
 		return OK;
 	}
 
+	Error insert_range(Size p_pos, const T *p_values, Size p_count);
+	Error remove_range(Size p_index, Size p_count);
+
 	Size find(const T &p_val, Size p_from = 0) const;
 	Size rfind(const T &p_val, Size p_from = -1) const;
 	Size count(const T &p_val) const;
 
 	_FORCE_INLINE_ CowData() {}
 	_FORCE_INLINE_ ~CowData();
-	_FORCE_INLINE_ CowData(CowData<T> &p_from) { _ref(p_from); };
+	_FORCE_INLINE_ CowData(CowData &p_from) { _ref(p_from); };
 };
 
-template <typename T>
-void CowData<T>::_unref(void *p_data) {
+template <typename T, size_t alignment>
+void CowData<T, alignment>::_unref(void *p_data) {
 	if (!p_data) {
 		return;
 	}
@@ -259,11 +318,16 @@ void CowData<T>::_unref(void *p_data) {
 	if (refc->decrement() > 0) {
 		return; // still in use
 	}
-	// clean up
 
+	_free_data(p_data);
+}
+
+// Destroys the elements and frees the memory without checking the reference count.
+template <typename T, size_t alignment>
+void CowData<T, alignment>::_free_data(void *p_data) {
 	if constexpr (!std::is_trivially_destructible_v<T>) {
 		USize *count = _get_size();
-		T *data = (T *)(count + 1);
+		T *data = (T *)p_data;
 
 		for (USize i = 0; i < *count; ++i) {
 			// call destructors
@@ -272,11 +336,13 @@ void CowData<T>::_unref(void *p_data) {
 	}
 
 	// free mem
-	Memory::free_static(((uint8_t *)p_data) - DATA_OFFSET, false);
+	_free(((uint8_t *)p_data) - DATA_OFFSET);
 }
 
-template <typename T>
-typename CowData<T>::USize CowData<T>::_copy_on_write() {
+// Makes sure the data is only referenced by this CowData, copying it if needed.
+// A copy gets room for at least p_min_capacity elements.
+template <typename T, size_t alignment>
+typename CowData<T, alignment>::USize CowData<T, alignment>::_copy_on_write(USize p_min_capacity) {
 	if (!_ptr) {
 		return 0;
 	}
@@ -287,15 +353,18 @@ typename CowData<T>::USize CowData<T>::_copy_on_write() {
 	if (unlikely(rc > 1)) {
 		/* in use by more than me */
 		USize current_size = *_get_size();
+		USize capacity = MAX(_get_alloc_size(current_size) / sizeof(T), p_min_capacity);
 
-		uint8_t *mem_new = (uint8_t *)Memory::alloc_static(_get_alloc_size(current_size) + DATA_OFFSET, false);
+		uint8_t *mem_new = _alloc(capacity * sizeof(T) + DATA_OFFSET);
 		ERR_FAIL_NULL_V(mem_new, 0);
 
 		SafeNumeric<USize> *_refc_ptr = _get_refcount_ptr(mem_new);
+		USize *_capacity_ptr = _get_capacity_ptr(mem_new);
 		USize *_size_ptr = _get_size_ptr(mem_new);
 		T *_data_ptr = _get_data_ptr(mem_new);
 
 		new (_refc_ptr) SafeNumeric<USize>(1); //refcount
+		*(_capacity_ptr) = capacity; //capacity
 		*(_size_ptr) = current_size; //size
 
 		// initialize new elements
@@ -315,9 +384,32 @@ typename CowData<T>::USize CowData<T>::_copy_on_write() {
 	return rc;
 }
 
-template <typename T>
+// Allocates or reallocates the data to hold exactly p_capacity elements, which
+// must not be less than its size. The data must not be shared.
+template <typename T, size_t alignment>
+Error CowData<T, alignment>::_set_capacity(USize p_capacity, USize p_refcount) {
+	uint8_t *mem_new;
+	if (!_ptr) {
+		// alloc from scratch
+		mem_new = _alloc(p_capacity * sizeof(T) + DATA_OFFSET);
+		ERR_FAIL_NULL_V(mem_new, ERR_OUT_OF_MEMORY);
+		*(_get_size_ptr(mem_new)) = 0; //size, currently none
+		p_refcount = 1;
+	} else {
+		mem_new = _realloc(((uint8_t *)_ptr) - DATA_OFFSET, p_capacity * sizeof(T) + DATA_OFFSET, *_get_size() * sizeof(T) + DATA_OFFSET);
+		ERR_FAIL_NULL_V(mem_new, ERR_OUT_OF_MEMORY);
+	}
+
+	new (_get_refcount_ptr(mem_new)) SafeNumeric<USize>(p_refcount); //refcount
+	*(_get_capacity_ptr(mem_new)) = p_capacity;
+
+	_ptr = _get_data_ptr(mem_new);
+	return OK;
+}
+
+template <typename T, size_t alignment>
 template <bool p_ensure_zero>
-Error CowData<T>::resize(Size p_size) {
+Error CowData<T, alignment>::resize(Size p_size) {
 	ERR_FAIL_COND_V(p_size < 0, ERR_INVALID_PARAMETER);
 
 	Size current_size = size();
@@ -335,37 +427,14 @@ Error CowData<T>::resize(Size p_size) {
 
 	// possibly changing size, copy on write
 	USize rc = _copy_on_write();
-
-	USize current_alloc_size = _get_alloc_size(current_size);
-	USize alloc_size;
-	ERR_FAIL_COND_V(!_get_alloc_size_checked(p_size, &alloc_size), ERR_OUT_OF_MEMORY);
+	USize capacity = get_capacity();
 
 	if (p_size > current_size) {
-		if (alloc_size != current_alloc_size) {
-			if (current_size == 0) {
-				// alloc from scratch
-				uint8_t *mem_new = (uint8_t *)Memory::alloc_static(alloc_size + DATA_OFFSET, false);
-				ERR_FAIL_NULL_V(mem_new, ERR_OUT_OF_MEMORY);
-
-				SafeNumeric<USize> *_refc_ptr = _get_refcount_ptr(mem_new);
-				USize *_size_ptr = _get_size_ptr(mem_new);
-				T *_data_ptr = _get_data_ptr(mem_new);
-
-				new (_refc_ptr) SafeNumeric<USize>(1); //refcount
-				*(_size_ptr) = 0; //size, currently none
-
-				_ptr = _data_ptr;
-			} else {
-				uint8_t *mem_new = (uint8_t *)Memory::realloc_static(((uint8_t *)_ptr) - DATA_OFFSET, alloc_size + DATA_OFFSET, false);
-				ERR_FAIL_NULL_V(mem_new, ERR_OUT_OF_MEMORY);
-
-				SafeNumeric<USize> *_refc_ptr = _get_refcount_ptr(mem_new);
-				T *_data_ptr = _get_data_ptr(mem_new);
-
-				new (_refc_ptr) SafeNumeric<USize>(rc); //refcount
-
-				_ptr = _data_ptr;
-			}
+		if (USize(p_size) > capacity) {
+			USize alloc_size;
+			ERR_FAIL_COND_V(!_get_alloc_size_checked(p_size, &alloc_size), ERR_OUT_OF_MEMORY);
+			Error err = _set_capacity(alloc_size / sizeof(T), rc);
+			ERR_FAIL_COND_V(err, err);
 		}
 
 		// construct the newly created elements
@@ -389,26 +458,129 @@ Error CowData<T>::resize(Size p_size) {
 			}
 		}
 
-		if (alloc_size != current_alloc_size) {
-			uint8_t *mem_new = (uint8_t *)Memory::realloc_static(((uint8_t *)_ptr) - DATA_OFFSET, alloc_size + DATA_OFFSET, false);
-			ERR_FAIL_NULL_V(mem_new, ERR_OUT_OF_MEMORY);
+		*_get_size() = p_size;
+
+		// Only give memory back once most of it is unused, so shrinking a bit
+		// and growing again (or filling after reserve()) doesn't reallocate.
+		USize fit_capacity = _get_alloc_size(p_size) / sizeof(T);
+		if (fit_capacity <= capacity / 4) {
+			Error err = _set_capacity(fit_capacity, rc);
+			ERR_FAIL_COND_V(err, err);
+		}
+	}
+
+	return OK;
+}
+
+// Makes room for at least p_capacity elements, so growing up to it doesn't reallocate.
+template <typename T, size_t alignment>
+Error CowData<T, alignment>::reserve(Size p_capacity) {
+	ERR_FAIL_COND_V(p_capacity < 0, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(USize(p_capacity) > MAX_INT / sizeof(T), ERR_OUT_OF_MEMORY);
+
+	USize rc = _copy_on_write(p_capacity);
+	if (USize(p_capacity) <= USize(get_capacity())) {
+		return OK;
+	}
+	return _set_capacity(p_capacity, rc);
+}
+
+// Reallocates the data to hold exactly its elements.
+template <typename T, size_t alignment>
+Error CowData<T, alignment>::shrink_to_fit() {
+	if (!_ptr) {
+		return OK;
+	}
+	if (size() == 0) {
+		_unref(_ptr);
+		_ptr = nullptr;
+		return OK;
+	}
 
-			SafeNumeric<USize> *_refc_ptr = _get_refcount_ptr(mem_new);
-			T *_data_ptr = _get_data_ptr(mem_new);
+	USize rc = _copy_on_write();
+	if (USize(size()) == USize(get_capacity())) {
+		return OK;
+	}
+	return _set_capacity(size(), rc);
+}
 
-			new (_refc_ptr) SafeNumeric<USize>(rc); //refcount
+// Grows by p_count elements and shifts the ones from p_pos to the end, leaving
+// p_count assignable (default constructed or moved-from) elements at p_pos.
+template <typename T, size_t alignment>
+Error CowData<T, alignment>::_insert_space(Size p_pos, Size p_count) {
+	const Size len = size();
+	Error err = resize(len + p_count);
+	ERR_FAIL_COND_V(err, err);
 
-			_ptr = _data_ptr;
+	const Size tail = len - p_pos;
+	if (tail == 0) {
+		return OK;
+	}
+	if constexpr (std::is_trivially_copyable_v<T>) {
+		memmove((void *)(_ptr + p_pos + p_count), (const void *)(_ptr + p_pos), tail * sizeof(T));
+	} else {
+		for (Size i = len + p_count - 1; i >= p_pos + p_count; i--) {
+			_ptr[i] = std::move(_ptr[i - p_count]);
 		}
+	}
+	return OK;
+}
 
-		*_get_size() = p_size;
+template <typename T, size_t alignment>
+Error CowData<T, alignment>::insert_range(Size p_pos, const T *p_values, Size p_count) {
+	ERR_FAIL_INDEX_V(p_pos, size() + 1, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(p_count < 0, ERR_INVALID_PARAMETER);
+	if (p_count == 0) {
+		return OK;
 	}
+	ERR_FAIL_NULL_V(p_values, ERR_INVALID_PARAMETER);
 
+	if (unlikely(_ptr && p_values + p_count > _ptr && p_values < _ptr + size())) {
+		// Inserting part of itself, which is moved by the insertion, so copy it first.
+		CowData copy;
+		Error err = copy.insert_range(0, p_values, p_count);
+		ERR_FAIL_COND_V(err, err);
+		return insert_range(p_pos, copy._ptr, p_count);
+	}
+
+	Error err = _insert_space(p_pos, p_count);
+	ERR_FAIL_COND_V(err, err);
+
+	if constexpr (std::is_trivially_copyable_v<T>) {
+		memcpy((void *)(_ptr + p_pos), (const void *)p_values, p_count * sizeof(T));
+	} else {
+		for (Size i = 0; i < p_count; i++) {
+			_ptr[p_pos + i] = p_values[i];
+		}
+	}
 	return OK;
 }
 
-template <typename T>
-typename CowData<T>::Size CowData<T>::find(const T &p_val, Size p_from) const {
+template <typename T, size_t alignment>
+Error CowData<T, alignment>::remove_range(Size p_index, Size p_count) {
+	const Size len = size();
+	// An empty range at the end is valid, e.g. `remove_range(i, size() - i)` with `i == size()`.
+	ERR_FAIL_INDEX_V(p_index, len + 1, ERR_INVALID_PARAMETER);
+	ERR_FAIL_COND_V(p_count < 0 || p_count > len - p_index, ERR_INVALID_PARAMETER);
+	if (p_count == 0) {
+		return OK;
+	}
+
+	_copy_on_write();
+	const Size tail = len - p_index - p_count;
+	if constexpr (std::is_trivially_copyable_v<T>) {
+		memmove((void *)(_ptr + p_index), (const void *)(_ptr + p_index + p_count), tail * sizeof(T));
+	} else {
+		for (Size i = p_index; i < p_index + tail; i++) {
+			_ptr[i] = std::move(_ptr[i + p_count]);
+		}
+	}
+
+	return resize(len - p_count);
+}
+
+template <typename T, size_t alignment>
+typename CowData<T, alignment>::Size CowData<T, alignment>::find(const T &p_val, Size p_from) const {
 	Size ret = -1;
 
 	if (p_from < 0 || size() == 0) {
@@ -425,8 +597,8 @@ typename CowData<T>::Size CowData<T>::find(const T &p_val, Size p_from) const {
 	return ret;
 }
 
-template <typename T>
-typename CowData<T>::Size CowData<T>::rfind(const T &p_val, Size p_from) const {
+template <typename T, size_t alignment>
+typename CowData<T, alignment>::Size CowData<T, alignment>::rfind(const T &p_val, Size p_from) const {
 	const Size s = size();
 
 	if (p_from < 0) {
@@ -444,8 +616,8 @@ typename CowData<T>::Size CowData<T>::rfind(const T &p_val, Size p_from) const {
 	return -1;
 }
 
-template <typename T>
-typename CowData<T>::Size CowData<T>::count(const T &p_val) const {
+template <typename T, size_t alignment>
+typename CowData<T, alignment>::Size CowData<T, alignment>::count(const T &p_val) const {
 	Size amount = 0;
 	for (Size i = 0; i < size(); i++) {
 		if (get(i) == p_val) {
@@ -455,13 +627,13 @@ typename CowData<T>::Size CowData<T>::count(const T &p_val) const {
 	return amount;
 }
 
-template <typename T>
-void CowData<T>::_ref(const CowData *p_from) {
+template <typename T, size_t alignment>
+void CowData<T, alignment>::_ref(const CowData *p_from) {
 	_ref(*p_from);
 }
 
-template <typename T>
-void CowData<T>::_ref(const CowData &p_from) {
+template <typename T, size_t alignment>
+void CowData<T, alignment>::_ref(const CowData &p_from) {
 	if (_ptr == p_from._ptr) {
 		return; // self assign, do nothing.
 	}
@@ -478,8 +650,8 @@ void CowData<T>::_ref(const CowData &p_from) {
 	}
 }
 
-template <typename T>
-CowData<T>::~CowData() {
+template <typename T, size_t alignment>
+CowData<T, alignment>::~CowData() {
 	_unref(_ptr);
 }
 
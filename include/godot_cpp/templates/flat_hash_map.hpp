@@ -0,0 +1,211 @@
+/**************************************************************************/
+/*  flat_hash_map.hpp                                                     */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_FLAT_HASH_MAP_HPP
+#define GODOT_FLAT_HASH_MAP_HPP
+
+#include <godot_cpp/templates/flat_hash_table.hpp>
+#include <godot_cpp/templates/pair.hpp>
+
+namespace godot {
+
+/**
+ * A hash map storing its key/value pairs inline in an open addressing table
+ * (see FlatHashTable), with the same interface as HashMap.
+ *
+ * Compared to HashMap, lookups don't go through separately allocated elements
+ * and iteration is a linear walk over the table. In exchange the iteration
+ * order is unspecified rather than the insertion order (so there is no
+ * last(), operator--() nor front insertion), and inserting or erasing can
+ * invalidate iterators and pointers to the values.
+ *
+ * The assignment operator copy the pairs from one map to the other.
+ */
+
+template <typename TKey, typename TValue,
+		typename Hasher = HashMapHasherDefault,
+		typename Comparator = HashMapComparatorDefault<TKey>>
+class FlatHashMap {
+	struct SlotKey {
+		static _FORCE_INLINE_ const TKey &get(const KeyValue<TKey, TValue> &p_slot) { return p_slot.key; }
+	};
+
+	typedef KeyValue<TKey, TValue> Pair;
+	typedef FlatHashTable<Pair, TKey, SlotKey, Hasher, Comparator> Table;
+
+	Table table;
+
+	// Takes copies since the value can be an element of the map (e.g. `insert(k, map[other])`),
+	// which a rehash frees before the new pair is built.
+	_FORCE_INLINE_ uint32_t _insert(TKey p_key, TValue p_value) {
+		bool inserted = false;
+		uint32_t index = table.find_or_prepare_insert(p_key, inserted);
+		if (inserted) {
+			memnew_placement(&table.get_slot(index), Pair(p_key, p_value));
+		} else {
+			table.get_slot(index).value = p_value;
+		}
+		return index;
+	}
+
+public:
+	_FORCE_INLINE_ uint32_t get_capacity() const { return table.get_capacity(); }
+	_FORCE_INLINE_ uint32_t size() const { return table.size(); }
+
+	/* Standard Godot Container API */
+
+	bool is_empty() const {
+		return table.size() == 0;
+	}
+
+	void clear() {
+		table.clear();
+	}
+
+	// Also releases the memory.
+	void reset() {
+		table.reset();
+	}
+
+	TValue &get(const TKey &p_key) {
+		uint32_t index = table.find(p_key);
+		CRASH_COND_MSG(index == Table::NOT_FOUND, "FlatHashMap key not found.");
+		return table.get_slot(index).value;
+	}
+
+	const TValue &get(const TKey &p_key) const {
+		uint32_t index = table.find(p_key);
+		CRASH_COND_MSG(index == Table::NOT_FOUND, "FlatHashMap key not found.");
+		return table.get_slot(index).value;
+	}
+
+	const TValue *getptr(const TKey &p_key) const {
+		uint32_t index = table.find(p_key);
+		if (index != Table::NOT_FOUND) {
+			return &table.get_slot(index).value;
+		}
+		return nullptr;
+	}
+
+	TValue *getptr(const TKey &p_key) {
+		uint32_t index = table.find(p_key);
+		if (index != Table::NOT_FOUND) {
+			return &table.get_slot(index).value;
+		}
+		return nullptr;
+	}
+
+	_FORCE_INLINE_ bool has(const TKey &p_key) const {
+		return table.find(p_key) != Table::NOT_FOUND;
+	}
+
+	bool erase(const TKey &p_key) {
+		return table.erase(p_key);
+	}
+
+	// Reserves space for a number of elements, useful to avoid many resizes and rehashes.
+	void reserve(uint32_t p_new_capacity) {
+		table.reserve(p_new_capacity);
+	}
+
+	/** Iterator API **/
+
+	typedef typename Table::ConstIterator ConstIterator;
+	typedef typename Table::Iterator Iterator;
+
+	_FORCE_INLINE_ Iterator begin() {
+		return table.begin();
+	}
+	_FORCE_INLINE_ Iterator end() {
+		return Iterator();
+	}
+
+	_FORCE_INLINE_ Iterator find(const TKey &p_key) {
+		return table.iterator_at(table.find(p_key));
+	}
+
+	_FORCE_INLINE_ void remove(const Iterator &p_iter) {
+		if (p_iter) {
+			table.erase_index(table.get_index(p_iter));
+		}
+	}
+
+	_FORCE_INLINE_ ConstIterator begin() const {
+		return table.begin();
+	}
+	_FORCE_INLINE_ ConstIterator end() const {
+		return ConstIterator();
+	}
+
+	_FORCE_INLINE_ ConstIterator find(const TKey &p_key) const {
+		return table.iterator_at(table.find(p_key));
+	}
+
+	/* Indexing */
+
+	const TValue &operator[](const TKey &p_key) const {
+		uint32_t index = table.find(p_key);
+		CRASH_COND(index == Table::NOT_FOUND);
+		return table.get_slot(index).value;
+	}
+
+	TValue &operator[](const TKey &p_key) {
+		bool inserted = false;
+		Pair &slot = table.get_slot(table.find_or_prepare_insert(p_key, inserted));
+		if (inserted) {
+			memnew_placement(&slot, Pair(p_key, TValue()));
+		}
+		return slot.value;
+	}
+
+	/* Insert */
+
+	Iterator insert(const TKey &p_key, const TValue &p_value) {
+		return table.iterator_at(_insert(p_key, p_value));
+	}
+
+	/* Constructors */
+
+	FlatHashMap(const FlatHashMap &p_other) :
+			table(p_other.table) {}
+
+	void operator=(const FlatHashMap &p_other) {
+		table = p_other.table;
+	}
+
+	FlatHashMap(uint32_t p_initial_capacity) {
+		reserve(p_initial_capacity);
+	}
+	FlatHashMap() {}
+};
+
+} // namespace godot
+
+#endif // GODOT_FLAT_HASH_MAP_HPP
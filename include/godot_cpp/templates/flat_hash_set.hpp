@@ -0,0 +1,139 @@
+/**************************************************************************/
+/*  flat_hash_set.hpp                                                     */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_FLAT_HASH_SET_HPP
+#define GODOT_FLAT_HASH_SET_HPP
+
+#include <godot_cpp/templates/flat_hash_table.hpp>
+
+namespace godot {
+
+/**
+ * A hash set storing its keys inline in an open addressing table (see
+ * FlatHashTable), with the same interface as HashSet.
+ *
+ * The iteration order is unspecified rather than the insertion order (so there
+ * is no last()), and inserting or erasing can invalidate iterators.
+ */
+
+template <typename TKey,
+		typename Hasher = HashMapHasherDefault,
+		typename Comparator = HashMapComparatorDefault<TKey>>
+class FlatHashSet {
+	struct SlotKey {
+		static _FORCE_INLINE_ const TKey &get(const TKey &p_slot) { return p_slot; }
+	};
+
+	typedef FlatHashTable<TKey, TKey, SlotKey, Hasher, Comparator> Table;
+
+	Table table;
+
+public:
+	_FORCE_INLINE_ uint32_t get_capacity() const { return table.get_capacity(); }
+	_FORCE_INLINE_ uint32_t size() const { return table.size(); }
+
+	/* Standard Godot Container API */
+
+	bool is_empty() const {
+		return table.size() == 0;
+	}
+
+	void clear() {
+		table.clear();
+	}
+
+	_FORCE_INLINE_ bool has(const TKey &p_key) const {
+		return table.find(p_key) != Table::NOT_FOUND;
+	}
+
+	bool erase(const TKey &p_key) {
+		return table.erase(p_key);
+	}
+
+	// Reserves space for a number of elements, useful to avoid many resizes and rehashes.
+	void reserve(uint32_t p_new_capacity) {
+		table.reserve(p_new_capacity);
+	}
+
+	/** Iterator API **/
+
+	typedef typename Table::ConstIterator Iterator;
+
+	_FORCE_INLINE_ Iterator begin() const {
+		return table.begin();
+	}
+	_FORCE_INLINE_ Iterator end() const {
+		return Iterator();
+	}
+
+	_FORCE_INLINE_ Iterator find(const TKey &p_key) const {
+		return table.iterator_at(table.find(p_key));
+	}
+
+	_FORCE_INLINE_ void remove(const Iterator &p_iter) {
+		if (p_iter) {
+			table.erase_index(table.get_index(p_iter));
+		}
+	}
+
+	/* Insert */
+
+	Iterator insert(const TKey &p_key) {
+		bool inserted = false;
+		uint32_t index = table.find_or_prepare_insert(p_key, inserted);
+		if (inserted) {
+			memnew_placement(&table.get_slot(index), TKey(p_key));
+		}
+		return table.iterator_at(index);
+	}
+
+	/* Constructors */
+
+	FlatHashSet(const FlatHashSet &p_other) :
+			table(p_other.table) {}
+
+	void operator=(const FlatHashSet &p_other) {
+		table = p_other.table;
+	}
+
+	FlatHashSet(uint32_t p_initial_capacity) {
+		reserve(p_initial_capacity);
+	}
+	FlatHashSet() {}
+
+	// Also releases the memory.
+	void reset() {
+		table.reset();
+	}
+};
+
+} // namespace godot
+
+#endif // GODOT_FLAT_HASH_SET_HPP
@@ -0,0 +1,568 @@
+/**************************************************************************/
+/*  flat_hash_table.hpp                                                   */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_FLAT_HASH_TABLE_HPP
+#define GODOT_FLAT_HASH_TABLE_HPP
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/memory.hpp>
+#include <godot_cpp/templates/hashfuncs.hpp>
+
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GODOT_FLAT_HASH_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define GODOT_FLAT_HASH_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace godot {
+
+/**
+ * Open addressing hash table backing FlatHashMap and FlatHashSet, following
+ * the Swiss table design.
+ *
+ * Slots are stored inline in a single allocation together with one control
+ * byte per slot. A control byte is either empty, deleted, or holds 7 bits of
+ * the hash of the key in the slot. Lookups compare the control bytes of a
+ * whole group of slots at once (16 with SSE2, 8 with NEON or the portable
+ * fallback) and only touch the slots whose 7 bits match, so a lookup is
+ * usually a single cache miss for the control bytes and one for the slot.
+ *
+ * The capacity is a power of 2 minus 1, the byte past the last slot is a
+ * sentinel that ends iteration, followed by a copy of the first group of
+ * control bytes so groups can be loaded at any position without wrapping.
+ */
+
+namespace FlatHash {
+
+enum : int8_t {
+	CTRL_EMPTY = -128,
+	CTRL_DELETED = -2,
+	CTRL_SENTINEL = -1,
+};
+
+_FORCE_INLINE_ uint32_t count_trailing_zeros(uint64_t p_value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, p_value);
+	return index;
+#else
+	return __builtin_ctzll(p_value);
+#endif
+}
+
+_FORCE_INLINE_ uint32_t count_leading_zeros(uint64_t p_value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, p_value);
+	return 63 - index;
+#else
+	return __builtin_clzll(p_value);
+#endif
+}
+
+// Set of matching slots in a group, with SHIFT bits per slot (only the highest one set).
+template <uint32_t WIDTH, uint32_t SHIFT>
+class BitMask {
+	uint64_t mask;
+
+	static constexpr uint32_t UNUSED_BITS = 64 - (WIDTH << SHIFT);
+
+public:
+	_FORCE_INLINE_ explicit operator bool() const { return mask != 0; }
+	_FORCE_INLINE_ uint32_t lowest() const { return count_trailing_zeros(mask) >> SHIFT; }
+	_FORCE_INLINE_ void clear_lowest() { mask &= mask - 1; }
+
+	// Number of slots not in the set at the start and at the end of the group.
+	_FORCE_INLINE_ uint32_t trailing_zeros() const { return mask ? lowest() : WIDTH; }
+	_FORCE_INLINE_ uint32_t leading_zeros() const { return mask ? (count_leading_zeros(mask) - UNUSED_BITS) >> SHIFT : WIDTH; }
+
+	_FORCE_INLINE_ explicit BitMask(uint64_t p_mask) :
+			mask(p_mask) {}
+};
+
+#if defined(GODOT_FLAT_HASH_SSE2)
+
+struct Group {
+	static constexpr uint32_t WIDTH = 16;
+	typedef BitMask<WIDTH, 0> Mask;
+
+	__m128i ctrl;
+
+	_FORCE_INLINE_ Mask match(int8_t p_h2) const {
+		return Mask((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(p_h2), ctrl)));
+	}
+	_FORCE_INLINE_ Mask match_empty() const {
+		return Mask((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(CTRL_EMPTY), ctrl)));
+	}
+	// Empty and deleted are the only values lower than the sentinel.
+	_FORCE_INLINE_ Mask match_empty_or_deleted() const {
+		return Mask((uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(CTRL_SENTINEL), ctrl)));
+	}
+	_FORCE_INLINE_ Mask match_full_or_sentinel() const {
+		return Mask((uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(ctrl, _mm_set1_epi8(CTRL_DELETED))));
+	}
+
+	_FORCE_INLINE_ explicit Group(const int8_t *p_ctrl) {
+		ctrl = _mm_loadu_si128((const __m128i *)p_ctrl);
+	}
+};
+
+#elif defined(GODOT_FLAT_HASH_NEON)
+
+struct Group {
+	static constexpr uint32_t WIDTH = 8;
+	static constexpr uint64_t MSBS = 0x8080808080808080ULL;
+	typedef BitMask<WIDTH, 3> Mask;
+
+	int8x8_t ctrl;
+
+	_FORCE_INLINE_ Mask match(int8_t p_h2) const {
+		return Mask(vget_lane_u64(vreinterpret_u64_u8(vceq_s8(vdup_n_s8(p_h2), ctrl)), 0) & MSBS);
+	}
+	_FORCE_INLINE_ Mask match_empty() const {
+		return Mask(vget_lane_u64(vreinterpret_u64_u8(vceq_s8(vdup_n_s8(CTRL_EMPTY), ctrl)), 0) & MSBS);
+	}
+	_FORCE_INLINE_ Mask match_empty_or_deleted() const {
+		return Mask(vget_lane_u64(vreinterpret_u64_u8(vclt_s8(ctrl, vdup_n_s8(CTRL_SENTINEL))), 0) & MSBS);
+	}
+	_FORCE_INLINE_ Mask match_full_or_sentinel() const {
+		return Mask(vget_lane_u64(vreinterpret_u64_u8(vcgt_s8(ctrl, vdup_n_s8(CTRL_DELETED))), 0) & MSBS);
+	}
+
+	_FORCE_INLINE_ explicit Group(const int8_t *p_ctrl) {
+		ctrl = vld1_s8(p_ctrl);
+	}
+};
+
+#else
+
+// Portable fallback, matching 8 control bytes at once in a 64-bit integer.
+struct Group {
+	static constexpr uint32_t WIDTH = 8;
+	static constexpr uint64_t LSBS = 0x0101010101010101ULL;
+	static constexpr uint64_t MSBS = 0x8080808080808080ULL;
+	typedef BitMask<WIDTH, 3> Mask;
+
+	uint64_t ctrl;
+
+	// May report a false positive for a byte following a real match, which is harmless
+	// as the keys are compared anyway.
+	_FORCE_INLINE_ Mask match(int8_t p_h2) const {
+		const uint64_t x = ctrl ^ (LSBS * uint8_t(p_h2));
+		return Mask((x - LSBS) & ~x & MSBS);
+	}
+	// Empty is the only value with the high bit set and the second lowest bit clear.
+	_FORCE_INLINE_ Mask match_empty() const {
+		return Mask(ctrl & ~(ctrl << 6) & MSBS);
+	}
+	// Empty and deleted are the only values with the high bit set and the lowest bit clear.
+	_FORCE_INLINE_ Mask match_empty_or_deleted() const {
+		return Mask(ctrl & ~(ctrl << 7) & MSBS);
+	}
+	_FORCE_INLINE_ Mask match_full_or_sentinel() const {
+		return Mask((~ctrl | (ctrl << 7)) & MSBS);
+	}
+
+	_FORCE_INLINE_ explicit Group(const int8_t *p_ctrl) {
+		memcpy(&ctrl, p_ctrl, sizeof(ctrl));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		ctrl = __builtin_bswap64(ctrl);
+#endif
+	}
+};
+
+#endif
+
+} // namespace FlatHash
+
+// SlotKey::get(slot) returns the key stored in a slot.
+template <typename TSlot, typename TKey, typename SlotKey, typename Hasher, typename Comparator>
+class FlatHashTable {
+	static_assert(alignof(TSlot) <= alignof(max_align_t), "Over-aligned slots are not supported.");
+
+	typedef FlatHash::Group Group;
+
+public:
+	static constexpr uint32_t GROUP_WIDTH = Group::WIDTH;
+	static constexpr uint32_t MIN_CAPACITY = GROUP_WIDTH - 1;
+	static constexpr uint32_t MAX_CAPACITY = (1u << 31) - 1;
+	static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+private:
+	int8_t *ctrl = nullptr;
+	TSlot *slots = nullptr;
+	uint32_t capacity = 0; // Power of 2 minus 1, 0 until the first insertion.
+	uint32_t num_elements = 0;
+	uint32_t growth_left = 0; // Insertions left before rehashing, deleted slots are not reused until then.
+
+	// Maximum load factor is 7/8.
+	static _FORCE_INLINE_ uint32_t _get_max_elements(uint32_t p_capacity) {
+		return p_capacity - MAX(p_capacity / 8, 1u);
+	}
+
+	static _FORCE_INLINE_ size_t _get_ctrl_bytes(uint32_t p_capacity) {
+		const size_t bytes = p_capacity + GROUP_WIDTH;
+		return (bytes + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+	}
+
+	static _FORCE_INLINE_ uint32_t _hash(const TKey &p_key) {
+		// Mixed again since the lowest bits are used as they are.
+		return hash_fmix32(Hasher::hash(p_key));
+	}
+	static _FORCE_INLINE_ uint32_t _h1(uint32_t p_hash) { return p_hash >> 7; }
+	static _FORCE_INLINE_ int8_t _h2(uint32_t p_hash) { return int8_t(p_hash & 0x7F); }
+
+	// Also updates the copy of the first group after the sentinel.
+	_FORCE_INLINE_ void _set_ctrl(uint32_t p_index, int8_t p_value) {
+		ctrl[p_index] = p_value;
+		ctrl[((p_index - (GROUP_WIDTH - 1)) & capacity) + (GROUP_WIDTH - 1)] = p_value;
+	}
+
+	uint32_t _find_non_full(uint32_t p_hash) const {
+		uint32_t pos = _h1(p_hash) & capacity;
+		uint32_t step = 0;
+		while (true) {
+			typename Group::Mask mask = Group(ctrl + pos).match_empty_or_deleted();
+			if (mask) {
+				return (pos + mask.lowest()) & capacity;
+			}
+			step += GROUP_WIDTH;
+			pos = (pos + step) & capacity;
+		}
+	}
+
+	void _allocate(uint32_t p_capacity) {
+		const size_t ctrl_bytes = _get_ctrl_bytes(p_capacity);
+		uint8_t *mem = (uint8_t *)Memory::alloc_static(ctrl_bytes + sizeof(TSlot) * p_capacity);
+		CRASH_COND_MSG(!mem, "Out of memory");
+		ctrl = (int8_t *)mem;
+		slots = (TSlot *)(mem + ctrl_bytes);
+		capacity = p_capacity;
+		memset(ctrl, FlatHash::CTRL_EMPTY, p_capacity + GROUP_WIDTH);
+		ctrl[p_capacity] = FlatHash::CTRL_SENTINEL;
+	}
+
+	void _resize(uint32_t p_capacity) {
+		int8_t *old_ctrl = ctrl;
+		TSlot *old_slots = slots;
+		const uint32_t old_capacity = capacity;
+
+		_allocate(p_capacity);
+		growth_left = _get_max_elements(p_capacity) - num_elements;
+
+		if (old_ctrl == nullptr) {
+			return;
+		}
+
+		for (uint32_t i = 0; i < old_capacity; i++) {
+			if (old_ctrl[i] >= 0) {
+				const uint32_t hash = _hash(SlotKey::get(old_slots[i]));
+				const uint32_t index = _find_non_full(hash);
+				_set_ctrl(index, _h2(hash));
+				if constexpr (std::is_trivially_copyable_v<TSlot>) {
+					memcpy((void *)&slots[index], (const void *)&old_slots[i], sizeof(TSlot));
+				} else {
+					memnew_placement(&slots[index], TSlot(std::move(old_slots[i])));
+					old_slots[i].~TSlot();
+				}
+			}
+		}
+
+		Memory::free_static(old_ctrl);
+	}
+
+	void _rehash_and_grow() {
+		if (capacity == 0) {
+			_resize(MIN_CAPACITY);
+		} else if (num_elements <= _get_max_elements(capacity) / 2) {
+			// Mostly deleted slots, clean them up without growing.
+			_resize(capacity);
+		} else {
+			ERR_FAIL_COND_MSG(capacity == MAX_CAPACITY, "Hash table maximum capacity reached, aborting insertion.");
+			_resize(capacity * 2 + 1);
+		}
+	}
+
+	void _destroy_slots() {
+		if constexpr (!std::is_trivially_destructible_v<TSlot>) {
+			for (uint32_t i = 0; i < capacity; i++) {
+				if (ctrl[i] >= 0) {
+					slots[i].~TSlot();
+				}
+			}
+		}
+	}
+
+public:
+	_FORCE_INLINE_ uint32_t get_capacity() const { return capacity; }
+	_FORCE_INLINE_ uint32_t size() const { return num_elements; }
+	_FORCE_INLINE_ TSlot &get_slot(uint32_t p_index) { return slots[p_index]; }
+	_FORCE_INLINE_ const TSlot &get_slot(uint32_t p_index) const { return slots[p_index]; }
+
+	uint32_t find(const TKey &p_key) const {
+		if (unlikely(num_elements == 0)) {
+			return NOT_FOUND;
+		}
+
+		const uint32_t hash = _hash(p_key);
+		const int8_t h2 = _h2(hash);
+		uint32_t pos = _h1(hash) & capacity;
+		uint32_t step = 0;
+		while (true) {
+			const Group group(ctrl + pos);
+			for (typename Group::Mask mask = group.match(h2); mask; mask.clear_lowest()) {
+				const uint32_t index = (pos + mask.lowest()) & capacity;
+				if (likely(Comparator::compare(SlotKey::get(slots[index]), p_key))) {
+					return index;
+				}
+			}
+			if (likely(group.match_empty())) {
+				return NOT_FOUND;
+			}
+			step += GROUP_WIDTH;
+			pos = (pos + step) & capacity;
+		}
+	}
+
+	// Returns the index of the slot for p_key. If r_inserted is true, the slot
+	// is uninitialized and must be constructed by the caller.
+	uint32_t find_or_prepare_insert(const TKey &p_key, bool &r_inserted) {
+		uint32_t index = find(p_key);
+		if (index != NOT_FOUND) {
+			r_inserted = false;
+			return index;
+		}
+
+		const uint32_t hash = _hash(p_key);
+		if (capacity != 0) {
+			index = _find_non_full(hash);
+		}
+		if (unlikely(capacity == 0 || (growth_left == 0 && ctrl[index] != FlatHash::CTRL_DELETED))) {
+			_rehash_and_grow();
+			CRASH_COND(growth_left == 0);
+			index = _find_non_full(hash);
+		}
+
+		growth_left -= ctrl[index] == FlatHash::CTRL_EMPTY;
+		_set_ctrl(index, _h2(hash));
+		num_elements++;
+		r_inserted = true;
+		return index;
+	}
+
+	void erase_index(uint32_t p_index) {
+		slots[p_index].~TSlot();
+		num_elements--;
+
+		// The slot can be marked as empty if no probe sequence could have gone
+		// past it, i.e. no group including it was ever full.
+		const typename Group::Mask empty_before = Group(ctrl + ((p_index - GROUP_WIDTH) & capacity)).match_empty();
+		const typename Group::Mask empty_after = Group(ctrl + p_index).match_empty();
+		const bool was_never_full = empty_before && empty_after && empty_after.trailing_zeros() + empty_before.leading_zeros() < GROUP_WIDTH;
+
+		_set_ctrl(p_index, was_never_full ? FlatHash::CTRL_EMPTY : FlatHash::CTRL_DELETED);
+		growth_left += was_never_full;
+	}
+
+	bool erase(const TKey &p_key) {
+		const uint32_t index = find(p_key);
+		if (index == NOT_FOUND) {
+			return false;
+		}
+		erase_index(index);
+		return true;
+	}
+
+	void reserve(uint32_t p_elements) {
+		uint32_t new_capacity = MAX(capacity, MIN_CAPACITY);
+		while (_get_max_elements(new_capacity) < p_elements) {
+			ERR_FAIL_COND_MSG(new_capacity == MAX_CAPACITY, "Hash table maximum capacity reached.");
+			new_capacity = new_capacity * 2 + 1;
+		}
+		if (new_capacity != capacity) {
+			_resize(new_capacity);
+		}
+	}
+
+	void clear() {
+		if (ctrl == nullptr) {
+			return;
+		}
+		_destroy_slots();
+		memset(ctrl, FlatHash::CTRL_EMPTY, capacity + GROUP_WIDTH);
+		ctrl[capacity] = FlatHash::CTRL_SENTINEL;
+		num_elements = 0;
+		growth_left = _get_max_elements(capacity);
+	}
+
+	void reset() {
+		if (ctrl == nullptr) {
+			return;
+		}
+		_destroy_slots();
+		Memory::free_static(ctrl);
+		ctrl = nullptr;
+		slots = nullptr;
+		capacity = 0;
+		num_elements = 0;
+		growth_left = 0;
+	}
+
+	/** Iterator API **/
+
+	// Walks the control bytes until the sentinel, which turns the iterator into end().
+	template <typename TS>
+	struct IteratorBase {
+		_FORCE_INLINE_ TS &operator*() const { return *slot; }
+		_FORCE_INLINE_ TS *operator->() const { return slot; }
+		_FORCE_INLINE_ IteratorBase &operator++() {
+			ctrl++;
+			slot++;
+			_skip_free();
+			return *this;
+		}
+
+		_FORCE_INLINE_ bool operator==(const IteratorBase &b) const { return slot == b.slot; }
+		_FORCE_INLINE_ bool operator!=(const IteratorBase &b) const { return slot != b.slot; }
+
+		_FORCE_INLINE_ explicit operator bool() const {
+			return slot != nullptr;
+		}
+
+		_FORCE_INLINE_ IteratorBase(const int8_t *p_ctrl, TS *p_slot) :
+				ctrl(p_ctrl), slot(p_slot) {}
+		_FORCE_INLINE_ IteratorBase() {}
+
+		template <typename TO, typename = std::enable_if_t<std::is_same_v<const TO, TS>>>
+		_FORCE_INLINE_ IteratorBase(const IteratorBase<TO> &p_it) :
+				ctrl(p_it.ctrl), slot(p_it.slot) {}
+
+	private:
+		template <typename>
+		friend struct IteratorBase;
+		friend class FlatHashTable;
+
+		const int8_t *ctrl = nullptr;
+		TS *slot = nullptr;
+
+		_FORCE_INLINE_ void _skip_free() {
+			if (likely(*ctrl >= 0)) {
+				return; // Tables are mostly full, check the next slot alone first.
+			}
+			while (true) {
+				const uint32_t skip = Group(ctrl).match_full_or_sentinel().trailing_zeros();
+				ctrl += skip;
+				slot += skip;
+				if (skip < GROUP_WIDTH) {
+					break;
+				}
+			}
+			if (*ctrl == FlatHash::CTRL_SENTINEL) {
+				ctrl = nullptr;
+				slot = nullptr;
+			}
+		}
+	};
+
+	typedef IteratorBase<TSlot> Iterator;
+	typedef IteratorBase<const TSlot> ConstIterator;
+
+	_FORCE_INLINE_ Iterator begin() {
+		if (num_elements == 0) {
+			return Iterator();
+		}
+		Iterator it(ctrl, slots);
+		it._skip_free();
+		return it;
+	}
+	_FORCE_INLINE_ ConstIterator begin() const {
+		if (num_elements == 0) {
+			return ConstIterator();
+		}
+		ConstIterator it(ctrl, slots);
+		it._skip_free();
+		return it;
+	}
+	_FORCE_INLINE_ Iterator iterator_at(uint32_t p_index) {
+		return p_index == NOT_FOUND ? Iterator() : Iterator(ctrl + p_index, slots + p_index);
+	}
+	_FORCE_INLINE_ ConstIterator iterator_at(uint32_t p_index) const {
+		return p_index == NOT_FOUND ? ConstIterator() : ConstIterator(ctrl + p_index, slots + p_index);
+	}
+	_FORCE_INLINE_ uint32_t get_index(const ConstIterator &p_it) const {
+		return uint32_t(p_it.slot - slots);
+	}
+
+	/* Constructors */
+
+	void operator=(const FlatHashTable &p_other) {
+		if (this == &p_other) {
+			return; // Ignore self assignment.
+		}
+		reset();
+		if (p_other.num_elements == 0) {
+			return;
+		}
+
+		// Same layout as the other table, no rehashing needed.
+		_allocate(p_other.capacity);
+		memcpy(ctrl, p_other.ctrl, capacity + GROUP_WIDTH);
+		for (uint32_t i = 0; i < capacity; i++) {
+			if (ctrl[i] >= 0) {
+				memnew_placement(&slots[i], TSlot(p_other.slots[i]));
+			}
+		}
+		num_elements = p_other.num_elements;
+		growth_left = p_other.growth_left;
+	}
+
+	FlatHashTable(const FlatHashTable &p_other) {
+		operator=(p_other);
+	}
+	FlatHashTable() {}
+
+	~FlatHashTable() {
+		reset();
+	}
+};
+
+} // namespace godot
+
+#endif // GODOT_FLAT_HASH_TABLE_HPP
@@ -0,0 +1,126 @@
+/**************************************************************************/
+/*  futex.hpp                                                             */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_FUTEX_HPP
+#define GODOT_FUTEX_HPP
+
+#include <godot_cpp/core/defs.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define _GODOT_FUTEX_LINUX
+#elif defined(__cpp_lib_atomic_wait)
+#define _GODOT_FUTEX_ATOMIC_WAIT
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace godot {
+
+// Lets threads sleep until a 32-bit atomic changes, without engine objects.
+//
+// Uses the futex syscall on Linux and Android, std::atomic::wait when built
+// as C++20, and a small table of condition variables otherwise. wait() can
+// return spuriously, so callers must re-check the value in a loop.
+class Futex {
+#if defined(_GODOT_FUTEX_LINUX)
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "The futex syscall needs a plain 32-bit word.");
+#endif
+
+#if !defined(_GODOT_FUTEX_LINUX) && !defined(_GODOT_FUTEX_ATOMIC_WAIT)
+	struct Bucket {
+		std::mutex mutex;
+		std::condition_variable cond;
+	};
+	static constexpr uint32_t BUCKET_COUNT = 64;
+
+	static Bucket &_get_bucket(const std::atomic<uint32_t> &p_word) {
+		static Bucket buckets[BUCKET_COUNT];
+		return buckets[(uintptr_t(&p_word) >> 4) % BUCKET_COUNT];
+	}
+#endif
+
+public:
+	// Sleeps while p_word holds p_expected.
+	static void wait(std::atomic<uint32_t> &p_word, uint32_t p_expected) {
+#if defined(_GODOT_FUTEX_LINUX)
+		syscall(SYS_futex, (uint32_t *)&p_word, FUTEX_WAIT_PRIVATE, p_expected, nullptr, nullptr, 0);
+#elif defined(_GODOT_FUTEX_ATOMIC_WAIT)
+		p_word.wait(p_expected, std::memory_order_acquire);
+#else
+		Bucket &bucket = _get_bucket(p_word);
+		std::unique_lock<std::mutex> lock(bucket.mutex);
+		if (p_word.load(std::memory_order_acquire) == p_expected) {
+			bucket.cond.wait(lock);
+		}
+#endif
+	}
+
+	// Wakes one thread sleeping on p_word. Change the value before calling it.
+	static void wake_one(std::atomic<uint32_t> &p_word) {
+#if defined(_GODOT_FUTEX_LINUX)
+		syscall(SYS_futex, (uint32_t *)&p_word, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#elif defined(_GODOT_FUTEX_ATOMIC_WAIT)
+		p_word.notify_one();
+#else
+		// Buckets are shared between words, so everyone has to check.
+		wake_all(p_word);
+#endif
+	}
+
+	// Wakes all threads sleeping on p_word. Change the value before calling it.
+	static void wake_all(std::atomic<uint32_t> &p_word) {
+#if defined(_GODOT_FUTEX_LINUX)
+		syscall(SYS_futex, (uint32_t *)&p_word, FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#elif defined(_GODOT_FUTEX_ATOMIC_WAIT)
+		p_word.notify_all();
+#else
+		Bucket &bucket = _get_bucket(p_word);
+		{
+			// Taking the lock orders this wake after any waiter that saw the old value.
+			std::lock_guard<std::mutex> lock(bucket.mutex);
+		}
+		bucket.cond.notify_all();
+#endif
+	}
+};
+
+} // namespace godot
+
+#undef _GODOT_FUTEX_LINUX
+#undef _GODOT_FUTEX_ATOMIC_WAIT
+
+#endif // GODOT_FUTEX_HPP
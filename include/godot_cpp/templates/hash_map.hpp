@@ -47,7 +47,7 @@ namespace godot {
  *
  * Keys and values are stored in a double linked list by insertion order. This
  * has a slight performance overhead on lookup, which can be mostly compensated
- * using a paged allocator if required.
+ * using a paged allocator if required (see PagedAllocator).
  *
  * The assignment operator copy the pairs from one map to the other.
  */
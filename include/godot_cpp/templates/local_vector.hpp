@@ -33,6 +33,7 @@
 
 #include <godot_cpp/core/error_macros.hpp>
 #include <godot_cpp/core/memory.hpp>
+#include <godot_cpp/templates/radix_sort.hpp>
 #include <godot_cpp/templates/sort_array.hpp>
 #include <godot_cpp/templates/vector.hpp>
 
@@ -43,13 +44,25 @@ namespace godot {
 
 // If tight, it grows strictly as much as needed.
 // Otherwise, it grows exponentially (the default and what you want in most cases).
-template <typename T, typename U = uint32_t, bool force_trivial = false, bool tight = false>
+// The data is aligned to `alignment` bytes, e.g. 32 or 64 for SIMD loads (see AlignedLocalVector).
+template <typename T, typename U = uint32_t, bool force_trivial = false, bool tight = false, size_t alignment = alignof(max_align_t)>
 class LocalVector {
+	static_assert((alignment & (alignment - 1)) == 0, "Alignment must be a power of 2.");
+
 private:
 	U count = 0;
 	U capacity = 0;
 	T *data = nullptr;
 
+	_FORCE_INLINE_ void _realloc_data(U p_capacity) {
+		if constexpr (alignment > alignof(max_align_t)) {
+			data = (T *)Memory::realloc_aligned_static(data, p_capacity * sizeof(T), count * sizeof(T), alignment, _MEM_CALL_SITE);
+		} else {
+			data = (T *)memrealloc(data, p_capacity * sizeof(T));
+		}
+		CRASH_COND_MSG(!data, "Out of memory");
+	}
+
 public:
 	T *ptr() {
 		return data;
@@ -66,8 +79,7 @@ public:
 			} else {
 				capacity <<= 1;
 			}
-			data = (T *)memrealloc(data, capacity * sizeof(T));
-			CRASH_COND_MSG(!data, "Out of memory");
+			_realloc_data(capacity);
 		}
 
 		if constexpr (!std::is_trivially_constructible<T>::value && !force_trivial) {
@@ -118,7 +130,11 @@ public:
 	_FORCE_INLINE_ void reset() {
 		clear();
 		if (data) {
-			memfree(data);
+			if constexpr (alignment > alignof(max_align_t)) {
+				Memory::free_aligned_static(data);
+			} else {
+				memfree(data);
+			}
 			data = nullptr;
 			capacity = 0;
 		}
@@ -129,8 +145,7 @@ public:
 		p_size = tight ? p_size : nearest_power_of_2_templated(p_size);
 		if (p_size > capacity) {
 			capacity = p_size;
-			data = (T *)memrealloc(data, capacity * sizeof(T));
-			CRASH_COND_MSG(!data, "Out of memory");
+			_realloc_data(capacity);
 		}
 	}
 
@@ -151,8 +166,7 @@ public:
 				while (capacity < p_size) {
 					capacity <<= 1;
 				}
-				data = (T *)memrealloc(data, capacity * sizeof(T));
-				CRASH_COND_MSG(!data, "Out of memory");
+				_realloc_data(capacity);
 			}
 			if constexpr (!std::is_trivially_constructible<T>::value && !force_trivial) {
 				for (U i = count; i < p_size; i++) {
@@ -272,6 +286,17 @@ public:
 		sorter.sort(data, len);
 	}
 
+	// Stable sort by an integer or floating point key, see RadixSort.
+	template <typename KeyGetter = _DefaultRadixKey<T>>
+	void radix_sort() {
+		if (count == 0) {
+			return;
+		}
+
+		RadixSort<T, KeyGetter> sorter;
+		sorter.sort(data, count);
+	}
+
 	void sort() {
 		sort_custom<_DefaultComparator<T>>();
 	}
@@ -338,6 +363,9 @@ public:
 template <typename T, typename U = uint32_t, bool force_trivial = false>
 using TightLocalVector = LocalVector<T, U, force_trivial, true>;
 
+template <typename T, size_t alignment, typename U = uint32_t, bool force_trivial = false>
+using AlignedLocalVector = LocalVector<T, U, force_trivial, false, alignment>;
+
 } // namespace godot
 
 #endif // GODOT_LOCAL_VECTOR_HPP
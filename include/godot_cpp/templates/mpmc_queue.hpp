@@ -0,0 +1,156 @@
+/**************************************************************************/
+/*  mpmc_queue.hpp                                                        */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_MPMC_QUEUE_HPP
+#define GODOT_MPMC_QUEUE_HPP
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/core/memory.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace godot {
+
+// Bounded lock-free queue for any amount of producer and consumer threads,
+// e.g. to hand results from ThreadWorkPool workers back to the main thread.
+//
+// Each cell of the ring has a sequence number telling whether it's ready to be
+// written or read for the current turn of the ring, so producers and consumers
+// only compete on their own index, which lives on its own cache line. Pushing
+// and popping never allocate. The capacity is rounded up to a power of 2.
+template <typename T>
+class MPMCQueue {
+	struct Cell {
+		std::atomic<uint32_t> sequence;
+		alignas(T) uint8_t data[sizeof(T)];
+
+		_FORCE_INLINE_ T *get() { return (T *)data; }
+	};
+
+	Cell *cells = nullptr;
+	uint32_t mask = 0;
+
+	// Padded by hand rather than with alignas(), which memnew doesn't honor.
+	uint8_t padding0[64];
+	std::atomic<uint32_t> enqueue_pos{ 0 };
+	uint8_t padding1[64];
+	std::atomic<uint32_t> dequeue_pos{ 0 };
+	uint8_t padding2[64];
+
+public:
+	// Returns false if the queue is full.
+	bool try_push(const T &p_value) {
+		uint32_t pos = enqueue_pos.load(std::memory_order_relaxed);
+		Cell *cell;
+		while (true) {
+			cell = &cells[pos & mask];
+			const int32_t diff = int32_t(cell->sequence.load(std::memory_order_acquire) - pos);
+			if (diff == 0) {
+				if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false; // The cell wasn't read since the last turn.
+			} else {
+				pos = enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+		memnew_placement(cell->get(), T(p_value));
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Returns false if the queue is empty.
+	bool try_pop(T &r_value) {
+		uint32_t pos = dequeue_pos.load(std::memory_order_relaxed);
+		Cell *cell;
+		while (true) {
+			cell = &cells[pos & mask];
+			const int32_t diff = int32_t(cell->sequence.load(std::memory_order_acquire) - (pos + 1));
+			if (diff == 0) {
+				if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false; // The cell wasn't written in this turn yet.
+			} else {
+				pos = dequeue_pos.load(std::memory_order_relaxed);
+			}
+		}
+		T *value = cell->get();
+		r_value = std::move(*value);
+		value->~T();
+		cell->sequence.store(pos + mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Approximate while other threads push or pop.
+	_FORCE_INLINE_ uint32_t size() const {
+		const int32_t size = int32_t(enqueue_pos.load(std::memory_order_relaxed) - dequeue_pos.load(std::memory_order_relaxed));
+		return size > 0 ? uint32_t(size) : 0;
+	}
+	_FORCE_INLINE_ bool is_empty() const { return size() == 0; }
+	_FORCE_INLINE_ uint32_t get_capacity() const { return mask + 1; }
+
+	explicit MPMCQueue(uint32_t p_capacity = 1024) {
+		CRASH_COND_MSG(p_capacity > 0x40000000, "MPMCQueue capacity is too large.");
+		const uint32_t capacity = nearest_power_of_2_templated(MAX(p_capacity, 2u));
+		mask = capacity - 1;
+		cells = (Cell *)memalloc(sizeof(Cell) * capacity);
+		for (uint32_t i = 0; i < capacity; i++) {
+			memnew_placement(&cells[i].sequence, std::atomic<uint32_t>(i));
+		}
+	}
+
+	MPMCQueue(const MPMCQueue &) = delete;
+	void operator=(const MPMCQueue &) = delete;
+
+	~MPMCQueue() {
+		if constexpr (!std::is_trivially_destructible_v<T>) {
+			// The cells written in the current turn of the ring are the ones left.
+			const uint32_t end = enqueue_pos.load(std::memory_order_acquire);
+			for (uint32_t pos = dequeue_pos.load(std::memory_order_acquire); pos != end; pos++) {
+				Cell &cell = cells[pos & mask];
+				if (cell.sequence.load(std::memory_order_acquire) == pos + 1) {
+					cell.get()->~T();
+				}
+			}
+		}
+		memfree(cells);
+	}
+};
+
+} // namespace godot
+
+#endif // GODOT_MPMC_QUEUE_HPP
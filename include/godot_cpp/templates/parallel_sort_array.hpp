@@ -0,0 +1,230 @@
+/**************************************************************************/
+/*  parallel_sort_array.hpp                                               */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_PARALLEL_SORT_ARRAY_HPP
+#define GODOT_PARALLEL_SORT_ARRAY_HPP
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/core/memory.hpp>
+#include <godot_cpp/templates/sort_array.hpp>
+#include <godot_cpp/templates/thread_work_pool.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+namespace godot {
+
+/**
+ * Sorts large arrays on the threads of a ThreadWorkPool, with the same
+ * Comparator and Validate parameters as SortArray.
+ *
+ * It's a sample sort: splitters taken from a sample of the array spread the
+ * elements over buckets (in parallel, through a scratch buffer), then the
+ * buckets are sorted in parallel with SortArray. Elements equal to a splitter
+ * get a bucket of their own which doesn't need sorting, so arrays with many
+ * duplicates still split evenly.
+ *
+ * Arrays shorter than PARALLEL_THRESHOLD, pools with less than two threads and
+ * pools that are already working, e.g. when called from one of their own tasks,
+ * are sorted by SortArray on the calling thread. The sort is not stable and T
+ * needs to be move constructible.
+ */
+template <typename T, typename Comparator = _DefaultComparator<T>, bool Validate = SORT_ARRAY_VALIDATE_ENABLED>
+class ParallelSortArray {
+	enum {
+		PARALLEL_THRESHOLD = 65536,
+		OVERSAMPLING = 16,
+		BUCKETS_PER_THREAD = 8,
+		MIN_CHUNK_SIZE = 16384,
+		MAX_SPLITTERS = 1023, // Keeps bucket indices within 16 bits.
+	};
+
+	struct SortData {
+		T *array = nullptr;
+		T *scratch = nullptr;
+		int len = 0;
+
+		const T *splitters = nullptr;
+		int splitter_count = 0;
+		int bucket_count = 0;
+
+		int chunk_size = 0;
+		int chunk_count = 0;
+
+		uint16_t *buckets = nullptr; // Bucket of every element.
+		int *offsets = nullptr; // Per chunk and bucket, where the chunk writes its elements of the bucket.
+		int *bucket_begin = nullptr; // bucket_count + 1 entries.
+	};
+
+	// Buckets are interleaved: 2 * i for elements between splitters i - 1 and i,
+	// 2 * i + 1 for elements equal to splitter i.
+	_FORCE_INLINE_ uint16_t _classify(const T &p_value, const T *p_splitters, int p_count) const {
+		int low = 0;
+		int high = p_count;
+		while (low < high) {
+			const int mid = (low + high) >> 1;
+			if (compare(p_splitters[mid], p_value)) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+		if (low < p_count && !compare(p_value, p_splitters[low])) {
+			return uint16_t(2 * low + 1);
+		}
+		return uint16_t(2 * low);
+	}
+
+	void _classify_chunk(uint32_t p_chunk, SortData *p_data) {
+		const int from = p_chunk * p_data->chunk_size;
+		const int to = MIN(from + p_data->chunk_size, p_data->len);
+		int *counts = p_data->offsets + p_chunk * p_data->bucket_count;
+		for (int i = from; i < to; i++) {
+			const uint16_t bucket = _classify(p_data->array[i], p_data->splitters, p_data->splitter_count);
+			p_data->buckets[i] = bucket;
+			counts[bucket]++;
+		}
+	}
+
+	void _scatter_chunk(uint32_t p_chunk, SortData *p_data) {
+		const int from = p_chunk * p_data->chunk_size;
+		const int to = MIN(from + p_data->chunk_size, p_data->len);
+		int *offsets = p_data->offsets + p_chunk * p_data->bucket_count;
+		for (int i = from; i < to; i++) {
+			memnew_placement(&p_data->scratch[offsets[p_data->buckets[i]]++], T(std::move(p_data->array[i])));
+		}
+	}
+
+	void _sort_bucket(uint32_t p_bucket, SortData *p_data) {
+		const int from = p_data->bucket_begin[p_bucket];
+		const int to = p_data->bucket_begin[p_bucket + 1];
+		if ((p_bucket & 1) == 0 && to - from > 1) {
+			SortArray<T, Comparator, Validate> sorter{ compare };
+			sorter.sort(p_data->scratch + from, to - from);
+		}
+		for (int i = from; i < to; i++) {
+			p_data->array[i] = std::move(p_data->scratch[i]);
+			p_data->scratch[i].~T();
+		}
+	}
+
+	// Picks up to p_max sorted, distinct splitters from a sample of the array.
+	int _pick_splitters(const T *p_array, int p_len, int p_max, T *r_splitters) const {
+		const int sample_count = (p_max + 1) * OVERSAMPLING;
+		T *sample = (T *)memalloc(sizeof(T) * sample_count);
+		uint32_t seed = 0x9E3779B9;
+		for (int i = 0; i < sample_count; i++) {
+			// Spread the samples evenly, with some jitter in case the array is periodic.
+			seed = seed * 1664525u + 1013904223u;
+			const int64_t index = (int64_t(i) * p_len + (seed >> 8) % (p_len / sample_count + 1)) / sample_count;
+			memnew_placement(&sample[i], T(p_array[MIN(index, int64_t(p_len - 1))]));
+		}
+
+		SortArray<T, Comparator, Validate> sorter{ compare };
+		sorter.sort(sample, sample_count);
+
+		int count = 0;
+		for (int i = OVERSAMPLING; i < sample_count; i += OVERSAMPLING) {
+			if (count == 0 || compare(r_splitters[count - 1], sample[i])) {
+				memnew_placement(&r_splitters[count], T(sample[i]));
+				count++;
+			}
+		}
+
+		for (int i = 0; i < sample_count; i++) {
+			sample[i].~T();
+		}
+		memfree(sample);
+		return count;
+	}
+
+public:
+	Comparator compare;
+
+	void sort(T *p_array, int p_len, ThreadWorkPool &p_pool) {
+		const int thread_count = p_pool.get_thread_count();
+		if (p_len < PARALLEL_THRESHOLD || thread_count < 2 || p_pool.is_working()) {
+			SortArray<T, Comparator, Validate> sorter{ compare };
+			sorter.sort(p_array, p_len);
+			return;
+		}
+
+		SortData data;
+		data.array = p_array;
+		data.len = p_len;
+
+		T *splitters = (T *)memalloc(sizeof(T) * MAX_SPLITTERS);
+		data.splitter_count = _pick_splitters(p_array, p_len, MIN(thread_count * BUCKETS_PER_THREAD - 1, (int)MAX_SPLITTERS), splitters);
+		data.splitters = splitters;
+		data.bucket_count = 2 * data.splitter_count + 1;
+
+		data.chunk_count = MIN(thread_count * 4, p_len / MIN_CHUNK_SIZE);
+		data.chunk_size = (p_len + data.chunk_count - 1) / data.chunk_count;
+
+		data.scratch = (T *)memalloc(sizeof(T) * p_len);
+		data.buckets = (uint16_t *)memalloc(sizeof(uint16_t) * p_len);
+		data.offsets = (int *)memalloc(sizeof(int) * data.chunk_count * data.bucket_count);
+		data.bucket_begin = (int *)memalloc(sizeof(int) * (data.bucket_count + 1));
+		memset(data.offsets, 0, sizeof(int) * data.chunk_count * data.bucket_count);
+
+		p_pool.do_work(data.chunk_count, this, &ParallelSortArray::_classify_chunk, &data);
+
+		// Turn the counts into offsets, with the elements of every bucket ordered by chunk.
+		int offset = 0;
+		for (int b = 0; b < data.bucket_count; b++) {
+			data.bucket_begin[b] = offset;
+			for (int c = 0; c < data.chunk_count; c++) {
+				int &entry = data.offsets[c * data.bucket_count + b];
+				const int count = entry;
+				entry = offset;
+				offset += count;
+			}
+		}
+		data.bucket_begin[data.bucket_count] = offset;
+
+		p_pool.do_work(data.chunk_count, this, &ParallelSortArray::_scatter_chunk, &data);
+		p_pool.do_work(data.bucket_count, this, &ParallelSortArray::_sort_bucket, &data);
+
+		for (int i = 0; i < data.splitter_count; i++) {
+			splitters[i].~T();
+		}
+		memfree(splitters);
+		memfree(data.scratch);
+		memfree(data.buckets);
+		memfree(data.offsets);
+		memfree(data.bucket_begin);
+	}
+};
+
+} // namespace godot
+
+#endif // GODOT_PARALLEL_SORT_ARRAY_HPP
@@ -0,0 +1,481 @@
+/**************************************************************************/
+/*  pdq_sort_array.hpp                                                    */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_PDQ_SORT_ARRAY_HPP
+#define GODOT_PDQ_SORT_ARRAY_HPP
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/templates/sort_array.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace godot {
+
+/**
+ * Pattern-defeating quicksort (pdqsort, by Orson Peters), with the same
+ * interface as SortArray.
+ *
+ * Compared to SortArray's introsort it:
+ * - picks pivots with a median of 3, or a pseudo median of 9 on large ranges,
+ * - detects ranges that were already partitioned and finishes them with a
+ *   bounded insertion sort, which makes sorted, reverse sorted and mostly
+ *   sorted arrays sort in about linear time,
+ * - groups the elements equal to the pivot when it equals the pivot of the
+ *   parent range, which makes arrays with many duplicates sort in about linear time,
+ * - breaks patterns by swapping a few elements after an unbalanced partition,
+ *   and falls back to heapsort if that keeps happening,
+ * - partitions in blocks without branches (BlockQuicksort) when Branchless is
+ *   true, which is the default for arithmetic types since their comparisons
+ *   are cheap and otherwise mispredicted half of the time.
+ *
+ * The sort is not stable. With Validate, an inconsistent comparator is
+ * reported instead of reading out of bounds, like SortArray does.
+ */
+template <typename T, typename Comparator = _DefaultComparator<T>, bool Validate = SORT_ARRAY_VALIDATE_ENABLED, bool Branchless = std::is_arithmetic_v<T>>
+class PDQSortArray {
+	enum {
+		INSERTION_SORT_THRESHOLD = 24,
+		NINTHER_THRESHOLD = 128,
+		PARTIAL_INSERTION_SORT_LIMIT = 8,
+		BLOCK_SIZE = 64,
+		CACHELINE_SIZE = 64,
+	};
+
+	static _FORCE_INLINE_ int _log2(int p_value) {
+#if defined(__GNUC__) || defined(__clang__)
+		return 31 - __builtin_clz((unsigned int)p_value);
+#else
+		int log = 0;
+		while (p_value >>= 1) {
+			log++;
+		}
+		return log;
+#endif
+	}
+
+	static _FORCE_INLINE_ unsigned char *_align_cacheline(unsigned char *p_ptr) {
+		return (unsigned char *)(((uintptr_t)p_ptr + CACHELINE_SIZE - 1) & ~(uintptr_t)(CACHELINE_SIZE - 1));
+	}
+
+	_FORCE_INLINE_ void _sort2(T *p_a, T *p_b) const {
+		if (compare(*p_b, *p_a)) {
+			SWAP(*p_a, *p_b);
+		}
+	}
+
+	_FORCE_INLINE_ void _sort3(T *p_a, T *p_b, T *p_c) const {
+		_sort2(p_a, p_b);
+		_sort2(p_b, p_c);
+		_sort2(p_a, p_b);
+	}
+
+	void _insertion_sort(T *p_begin, T *p_end) const {
+		if (p_begin == p_end) {
+			return;
+		}
+		for (T *cur = p_begin + 1; cur != p_end; ++cur) {
+			T *sift = cur;
+			T *sift_1 = cur - 1;
+			if (compare(*sift, *sift_1)) {
+				T tmp = std::move(*sift);
+				do {
+					*sift-- = std::move(*sift_1);
+				} while (sift != p_begin && compare(tmp, *--sift_1));
+				*sift = std::move(tmp);
+			}
+		}
+	}
+
+	// Needs an element not greater than any of the range right before p_begin.
+	// p_guard is the start of the whole array, only used to validate the comparator.
+	void _unguarded_insertion_sort(T *p_begin, T *p_end, const T *p_guard) const {
+		if (p_begin == p_end) {
+			return;
+		}
+		for (T *cur = p_begin + 1; cur != p_end; ++cur) {
+			T *sift = cur;
+			T *sift_1 = cur - 1;
+			if (compare(*sift, *sift_1)) {
+				T tmp = std::move(*sift);
+				do {
+					*sift-- = std::move(*sift_1);
+					if (Validate) {
+						ERR_BAD_COMPARE(sift_1 == p_guard);
+					}
+				} while (compare(tmp, *--sift_1));
+				*sift = std::move(tmp);
+			}
+		}
+	}
+
+	// Insertion sort that gives up once it moved more than PARTIAL_INSERTION_SORT_LIMIT elements.
+	// Returns true if the range is sorted.
+	bool _partial_insertion_sort(T *p_begin, T *p_end) const {
+		if (p_begin == p_end) {
+			return true;
+		}
+		size_t limit = 0;
+		for (T *cur = p_begin + 1; cur != p_end; ++cur) {
+			T *sift = cur;
+			T *sift_1 = cur - 1;
+			if (compare(*sift, *sift_1)) {
+				T tmp = std::move(*sift);
+				do {
+					*sift-- = std::move(*sift_1);
+				} while (sift != p_begin && compare(tmp, *--sift_1));
+				*sift = std::move(tmp);
+				limit += cur - sift;
+			}
+			if (limit > PARTIAL_INSERTION_SORT_LIMIT) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void _swap_offsets(T *p_first, T *p_last, unsigned char *p_offsets_l, unsigned char *p_offsets_r, size_t p_num, bool p_use_swaps) const {
+		if (p_use_swaps) {
+			// Needed for descending inputs, so partitioning them stays linear.
+			for (size_t i = 0; i < p_num; ++i) {
+				SWAP(*(p_first + p_offsets_l[i]), *(p_last - p_offsets_r[i]));
+			}
+		} else if (p_num > 0) {
+			// A cycle of moves instead of swaps.
+			T *l = p_first + p_offsets_l[0];
+			T *r = p_last - p_offsets_r[0];
+			T tmp(std::move(*l));
+			*l = std::move(*r);
+			for (size_t i = 1; i < p_num; ++i) {
+				l = p_first + p_offsets_l[i];
+				*r = std::move(*l);
+				r = p_last - p_offsets_r[i];
+				*l = std::move(*r);
+			}
+			*r = std::move(tmp);
+		}
+	}
+
+	// Partitions [p_begin, p_end) around the pivot *p_begin, elements equal to
+	// the pivot going to the right. Returns the position of the pivot, and in
+	// r_already_partitioned whether no element had to be swapped.
+	T *_partition_right(T *p_begin, T *p_end, bool &r_already_partitioned) const {
+		T pivot(std::move(*p_begin));
+		T *first = p_begin;
+		T *last = p_end;
+
+		// The median of 3 guarantees there is an element not less than the pivot.
+		while (compare(*++first, pivot)) {
+			if (Validate) {
+				ERR_BAD_COMPARE(first == p_end - 1);
+			}
+		}
+
+		// If the first element was already in place, nothing guarantees there is an element less than the pivot.
+		if (first - 1 == p_begin) {
+			while (first < last && !compare(*--last, pivot)) {
+			}
+		} else {
+			while (!compare(*--last, pivot)) {
+				if (Validate) {
+					ERR_BAD_COMPARE(last == p_begin);
+				}
+			}
+		}
+
+		r_already_partitioned = first >= last;
+
+		if constexpr (Branchless) {
+			if (!r_already_partitioned) {
+				SWAP(*first, *last);
+				++first;
+
+				unsigned char offsets_l_storage[BLOCK_SIZE + CACHELINE_SIZE];
+				unsigned char offsets_r_storage[BLOCK_SIZE + CACHELINE_SIZE];
+				unsigned char *offsets_l = _align_cacheline(offsets_l_storage);
+				unsigned char *offsets_r = _align_cacheline(offsets_r_storage);
+
+				T *offsets_l_base = first;
+				T *offsets_r_base = last;
+				size_t num_l = 0;
+				size_t num_r = 0;
+				size_t start_l = 0;
+				size_t start_r = 0;
+
+				while (first < last) {
+					// Decide how many elements go into each block, then fill the blocks
+					// with the offsets of the elements on the wrong side, without branching.
+					const size_t num_unknown = last - first;
+					const size_t left_split = num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0;
+					const size_t right_split = num_r == 0 ? (num_unknown - left_split) : 0;
+
+					if (left_split >= BLOCK_SIZE) {
+						for (size_t i = 0; i < BLOCK_SIZE;) {
+							offsets_l[num_l] = (unsigned char)i++;
+							num_l += !compare(*first, pivot);
+							++first;
+							offsets_l[num_l] = (unsigned char)i++;
+							num_l += !compare(*first, pivot);
+							++first;
+							offsets_l[num_l] = (unsigned char)i++;
+							num_l += !compare(*first, pivot);
+							++first;
+							offsets_l[num_l] = (unsigned char)i++;
+							num_l += !compare(*first, pivot);
+							++first;
+						}
+					} else {
+						for (size_t i = 0; i < left_split;) {
+							offsets_l[num_l] = (unsigned char)i++;
+							num_l += !compare(*first, pivot);
+							++first;
+						}
+					}
+
+					if (right_split >= BLOCK_SIZE) {
+						for (size_t i = 0; i < BLOCK_SIZE;) {
+							offsets_r[num_r] = (unsigned char)++i;
+							num_r += compare(*--last, pivot);
+							offsets_r[num_r] = (unsigned char)++i;
+							num_r += compare(*--last, pivot);
+							offsets_r[num_r] = (unsigned char)++i;
+							num_r += compare(*--last, pivot);
+							offsets_r[num_r] = (unsigned char)++i;
+							num_r += compare(*--last, pivot);
+						}
+					} else {
+						for (size_t i = 0; i < right_split;) {
+							offsets_r[num_r] = (unsigned char)++i;
+							num_r += compare(*--last, pivot);
+						}
+					}
+
+					// Swap as many misplaced elements as possible between both blocks.
+					const size_t num = MIN(num_l, num_r);
+					_swap_offsets(offsets_l_base, offsets_r_base, offsets_l + start_l, offsets_r + start_r, num, num_l == num_r);
+					num_l -= num;
+					num_r -= num;
+					start_l += num;
+					start_r += num;
+
+					if (num_l == 0) {
+						start_l = 0;
+						offsets_l_base = first;
+					}
+					if (num_r == 0) {
+						start_r = 0;
+						offsets_r_base = last;
+					}
+				}
+
+				// One of the blocks may still have misplaced elements, move them next to the other side.
+				if (num_l) {
+					offsets_l += start_l;
+					while (num_l--) {
+						SWAP(*(offsets_l_base + offsets_l[num_l]), *--last);
+					}
+					first = last;
+				}
+				if (num_r) {
+					offsets_r += start_r;
+					while (num_r--) {
+						SWAP(*(offsets_r_base - offsets_r[num_r]), *first);
+						++first;
+					}
+					last = first;
+				}
+			}
+		} else {
+			while (first < last) {
+				SWAP(*first, *last);
+				while (compare(*++first, pivot)) {
+					if (Validate) {
+						ERR_BAD_COMPARE(first == p_end - 1);
+					}
+				}
+				while (!compare(*--last, pivot)) {
+					if (Validate) {
+						ERR_BAD_COMPARE(last == p_begin);
+					}
+				}
+			}
+		}
+
+		T *pivot_pos = first - 1;
+		*p_begin = std::move(*pivot_pos);
+		*pivot_pos = std::move(pivot);
+		return pivot_pos;
+	}
+
+	// Like _partition_right(), but elements equal to the pivot go to the left.
+	// Used when the pivot equals the element before the range, so all the
+	// elements equal to it are placed in their final position at once.
+	T *_partition_left(T *p_begin, T *p_end) const {
+		T pivot(std::move(*p_begin));
+		T *first = p_begin;
+		T *last = p_end;
+
+		while (compare(pivot, *--last)) {
+			if (Validate) {
+				ERR_BAD_COMPARE(last == p_begin);
+			}
+		}
+
+		if (last + 1 == p_end) {
+			while (first < last && !compare(pivot, *++first)) {
+			}
+		} else {
+			while (!compare(pivot, *++first)) {
+				if (Validate) {
+					ERR_BAD_COMPARE(first == p_end - 1);
+				}
+			}
+		}
+
+		while (first < last) {
+			SWAP(*first, *last);
+			while (compare(pivot, *--last)) {
+				if (Validate) {
+					ERR_BAD_COMPARE(last == p_begin);
+				}
+			}
+			while (!compare(pivot, *++first)) {
+				if (Validate) {
+					ERR_BAD_COMPARE(first == p_end - 1);
+				}
+			}
+		}
+
+		T *pivot_pos = last;
+		*p_begin = std::move(*pivot_pos);
+		*pivot_pos = std::move(pivot);
+		return pivot_pos;
+	}
+
+	void _pdqsort_loop(T *p_begin, T *p_end, int p_bad_allowed, bool p_leftmost, const T *p_guard) const {
+		while (true) {
+			const ptrdiff_t size = p_end - p_begin;
+
+			if (size < INSERTION_SORT_THRESHOLD) {
+				if (p_leftmost) {
+					_insertion_sort(p_begin, p_end);
+				} else {
+					_unguarded_insertion_sort(p_begin, p_end, p_guard);
+				}
+				return;
+			}
+
+			// Move the pivot to p_begin: median of 3, or pseudo median of 9 (Tukey's ninther) on large ranges.
+			const ptrdiff_t s2 = size / 2;
+			if (size > NINTHER_THRESHOLD) {
+				_sort3(p_begin, p_begin + s2, p_end - 1);
+				_sort3(p_begin + 1, p_begin + (s2 - 1), p_end - 2);
+				_sort3(p_begin + 2, p_begin + (s2 + 1), p_end - 3);
+				_sort3(p_begin + (s2 - 1), p_begin + s2, p_begin + (s2 + 1));
+				SWAP(*p_begin, *(p_begin + s2));
+			} else {
+				_sort3(p_begin + s2, p_begin, p_end - 1);
+			}
+
+			// If the element before the range (the pivot of the parent) equals the pivot,
+			// all the elements equal to it are done after a partition to the left.
+			if (!p_leftmost && !compare(*(p_begin - 1), *p_begin)) {
+				p_begin = _partition_left(p_begin, p_end) + 1;
+				continue;
+			}
+
+			bool already_partitioned = false;
+			T *pivot_pos = _partition_right(p_begin, p_end, already_partitioned);
+
+			const ptrdiff_t l_size = pivot_pos - p_begin;
+			const ptrdiff_t r_size = p_end - (pivot_pos + 1);
+			const bool highly_unbalanced = l_size < size / 8 || r_size < size / 8;
+
+			if (highly_unbalanced) {
+				// Too many bad partitions, switch to heapsort to guarantee O(n log n).
+				if (--p_bad_allowed == 0) {
+					SortArray<T, Comparator, Validate> heap_sorter{ compare };
+					heap_sorter.partial_sort(0, int(size), int(size), p_begin);
+					return;
+				}
+
+				// Break patterns that may have caused the bad partition.
+				if (l_size >= INSERTION_SORT_THRESHOLD) {
+					SWAP(*p_begin, *(p_begin + l_size / 4));
+					SWAP(*(pivot_pos - 1), *(pivot_pos - l_size / 4));
+					if (l_size > NINTHER_THRESHOLD) {
+						SWAP(*(p_begin + 1), *(p_begin + (l_size / 4 + 1)));
+						SWAP(*(p_begin + 2), *(p_begin + (l_size / 4 + 2)));
+						SWAP(*(pivot_pos - 2), *(pivot_pos - (l_size / 4 + 1)));
+						SWAP(*(pivot_pos - 3), *(pivot_pos - (l_size / 4 + 2)));
+					}
+				}
+				if (r_size >= INSERTION_SORT_THRESHOLD) {
+					SWAP(*(pivot_pos + 1), *(pivot_pos + (1 + r_size / 4)));
+					SWAP(*(p_end - 1), *(p_end - r_size / 4));
+					if (r_size > NINTHER_THRESHOLD) {
+						SWAP(*(pivot_pos + 2), *(pivot_pos + (2 + r_size / 4)));
+						SWAP(*(pivot_pos + 3), *(pivot_pos + (3 + r_size / 4)));
+						SWAP(*(p_end - 2), *(p_end - (1 + r_size / 4)));
+						SWAP(*(p_end - 3), *(p_end - (2 + r_size / 4)));
+					}
+				}
+			} else if (already_partitioned && _partial_insertion_sort(p_begin, pivot_pos) && _partial_insertion_sort(pivot_pos + 1, p_end)) {
+				// Probably sorted already, and the insertion sorts confirmed it.
+				return;
+			}
+
+			// Recurse into the left side, loop on the right one.
+			_pdqsort_loop(p_begin, pivot_pos, p_bad_allowed, p_leftmost, p_guard);
+			p_begin = pivot_pos + 1;
+			p_leftmost = false;
+		}
+	}
+
+public:
+	Comparator compare;
+
+	inline void sort_range(int p_first, int p_last, T *p_array) const {
+		if (p_last - p_first > 1) {
+			_pdqsort_loop(p_array + p_first, p_array + p_last, _log2(p_last - p_first), true, p_array + p_first);
+		}
+	}
+
+	inline void sort(T *p_array, int p_len) const {
+		sort_range(0, p_len, p_array);
+	}
+};
+
+} // namespace godot
+
+#endif // GODOT_PDQ_SORT_ARRAY_HPP
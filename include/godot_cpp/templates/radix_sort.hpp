@@ -0,0 +1,166 @@
+/**************************************************************************/
+/*  radix_sort.hpp                                                        */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_RADIX_SORT_HPP
+#define GODOT_RADIX_SORT_HPP
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/memory.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace godot {
+
+template <typename T>
+struct _DefaultRadixKey {
+	_FORCE_INLINE_ const T &operator()(const T &p_value) const { return p_value; }
+};
+
+/**
+ * Least significant digit radix sort, for arrays sorted by an integer or
+ * floating point key: O(n) instead of the O(n log n) comparisons of SortArray,
+ * which makes a large difference on arrays of millions of elements.
+ *
+ * The key is the element itself, or what KeyGetter returns for it, e.g. to
+ * sort structs by a depth or Morton code member. Negative numbers sort before
+ * positive ones, and floats sort as with operator<, with -0.0 before 0.0 and
+ * NaNs at either end depending on their sign.
+ *
+ * The sort is stable. It moves the elements between the array and a scratch
+ * buffer of the same size, so T must be trivially copyable. A scratch buffer
+ * can be passed to reuse it between sorts, otherwise one is allocated.
+ * Digits where all keys are equal are skipped, so keys spanning a small range
+ * sort in fewer passes.
+ */
+template <typename T, typename KeyGetter = _DefaultRadixKey<T>>
+class RadixSort {
+	static_assert(std::is_trivially_copyable_v<T>, "RadixSort moves elements with memcpy, T must be trivially copyable.");
+
+	typedef std::remove_cv_t<std::remove_reference_t<decltype(std::declval<KeyGetter>()(std::declval<const T &>()))>> Key;
+	static_assert(std::is_integral_v<Key> || std::is_floating_point_v<Key>, "RadixSort keys must be integers or floating point numbers.");
+
+	typedef std::conditional_t<sizeof(Key) <= 4, uint32_t, uint64_t> Bits;
+
+	// 11 bit digits take one pass less than bytes for 32 bit keys and two less
+	// for 64 bit keys, while the histogram of a pass still fits in the L1 cache.
+	static constexpr uint32_t DIGIT_BITS = sizeof(Key) >= 4 ? 11 : 8;
+	static constexpr uint32_t DIGITS = 1 << DIGIT_BITS;
+	static constexpr uint32_t DIGIT_MASK = DIGITS - 1;
+	static constexpr uint32_t PASSES = (sizeof(Key) * 8 + DIGIT_BITS - 1) / DIGIT_BITS;
+
+	// Maps the key to an unsigned integer with the same order.
+	_FORCE_INLINE_ Bits _get_bits(const T &p_value) const {
+		const Key key = get_key(p_value);
+		if constexpr (std::is_floating_point_v<Key>) {
+			typedef std::conditional_t<sizeof(Key) == 4, uint32_t, uint64_t> FloatBits;
+			FloatBits bits;
+			memcpy(&bits, &key, sizeof(Key));
+			const FloatBits sign = FloatBits(1) << (sizeof(Key) * 8 - 1);
+			// Negative numbers have all their bits flipped so larger magnitudes sort first,
+			// positive numbers only their sign so they sort after the negative ones.
+			return Bits((bits & sign) ? ~bits : (bits | sign));
+		} else if constexpr (std::is_signed_v<Key>) {
+			return Bits(std::make_unsigned_t<Key>(key) ^ (std::make_unsigned_t<Key>(1) << (sizeof(Key) * 8 - 1)));
+		} else {
+			return Bits(key);
+		}
+	}
+
+public:
+	KeyGetter get_key;
+
+	void sort(T *p_array, int64_t p_len, T *p_scratch = nullptr) const {
+		ERR_FAIL_COND(p_len < 0);
+		if (p_len < 2) {
+			return;
+		}
+
+		uint64_t *histograms = (uint64_t *)memalloc(sizeof(uint64_t) * PASSES * DIGITS);
+		ERR_FAIL_NULL(histograms);
+		memset(histograms, 0, sizeof(uint64_t) * PASSES * DIGITS);
+		for (int64_t i = 0; i < p_len; i++) {
+			const Bits bits = _get_bits(p_array[i]);
+			for (uint32_t pass = 0; pass < PASSES; pass++) {
+				histograms[pass * DIGITS + ((bits >> (pass * DIGIT_BITS)) & DIGIT_MASK)]++;
+			}
+		}
+
+		T *scratch = p_scratch;
+		if (!scratch) {
+			scratch = (T *)memalloc(sizeof(T) * p_len);
+			if (unlikely(!scratch)) {
+				memfree(histograms);
+				ERR_FAIL_MSG("Out of memory.");
+			}
+		}
+
+		T *from = p_array;
+		T *to = scratch;
+		for (uint32_t pass = 0; pass < PASSES; pass++) {
+			uint64_t *histogram = histograms + pass * DIGITS;
+			const uint32_t shift = pass * DIGIT_BITS;
+			if (histogram[(_get_bits(from[0]) >> shift) & DIGIT_MASK] == uint64_t(p_len)) {
+				continue; // Same digit everywhere, nothing to do.
+			}
+
+			// Counts to offsets.
+			uint64_t offset = 0;
+			for (uint32_t digit = 0; digit < DIGITS; digit++) {
+				const uint64_t count = histogram[digit];
+				histogram[digit] = offset;
+				offset += count;
+			}
+
+			for (int64_t i = 0; i < p_len; i++) {
+				const uint32_t digit = (_get_bits(from[i]) >> shift) & DIGIT_MASK;
+				memcpy((void *)&to[histogram[digit]++], (const void *)&from[i], sizeof(T));
+			}
+
+			T *swap = from;
+			from = to;
+			to = swap;
+		}
+
+		if (from != p_array) {
+			memcpy((void *)p_array, (const void *)from, sizeof(T) * p_len);
+		}
+		if (!p_scratch) {
+			memfree(scratch);
+		}
+		memfree(histograms);
+	}
+};
+
+} // namespace godot
+
+#endif // GODOT_RADIX_SORT_HPP
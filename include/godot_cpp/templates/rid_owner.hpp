@@ -31,82 +31,244 @@
 #ifndef GODOT_RID_OWNER_HPP
 #define GODOT_RID_OWNER_HPP
 
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/math.hpp>
 #include <godot_cpp/core/memory.hpp>
 #include <godot_cpp/godot.hpp>
 #include <godot_cpp/templates/list.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
 #include <godot_cpp/templates/spin_lock.hpp>
-#include <godot_cpp/variant/utility_functions.hpp>
+#include <godot_cpp/variant/rid.hpp>
 
+#include <atomic>
 #include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
 #include <typeinfo>
 
 namespace godot {
 
+class RID_AllocBase {
+	static inline std::atomic<uint64_t> base_id{ 1 };
+	static inline std::atomic<uint32_t> thread_count{ 0 };
+
+protected:
+	// Validators are handed out in batches from a counter shared by every allocator,
+	// so RIDs are unique without asking the engine for an id on each allocation.
+	static constexpr uint32_t VALIDATOR_BATCH_SIZE = 256;
+
+	_FORCE_INLINE_ static uint32_t _next_validator(uint64_t &r_next, uint64_t &r_end) {
+		uint32_t validator;
+		do {
+			if (unlikely(r_next == r_end)) {
+				r_next = base_id.fetch_add(VALIDATOR_BATCH_SIZE, std::memory_order_relaxed);
+				r_end = r_next + VALIDATOR_BATCH_SIZE;
+			}
+			validator = uint32_t(r_next++ & 0x7FFFFFFF);
+			// Zero could make a null RID, and 0x7FFFFFFF would look free while uninitialized.
+		} while (unlikely(validator == 0 || validator == 0x7FFFFFFF));
+		return validator;
+	}
+
+	// RIDs are plain 64-bit ids, read and written directly instead of through the engine.
+	_FORCE_INLINE_ static RID _make_from_id(uint64_t p_id) {
+		RID rid;
+		memcpy(rid._native_ptr(), &p_id, sizeof(p_id));
+		return rid;
+	}
+
+	_FORCE_INLINE_ static uint64_t _get_id(const RID &p_rid) {
+		uint64_t id;
+		memcpy(&id, p_rid._native_ptr(), sizeof(id));
+		return id;
+	}
+
+	_FORCE_INLINE_ static uint32_t _get_thread_index() {
+#if defined(MACOS_ENABLED) && defined(HOT_RELOAD_ENABLED)
+		// Thread locals prevent unloading the library on macOS (see wrapped.hpp).
+		return uint32_t(std::hash<std::thread::id>()(std::this_thread::get_id()));
+#else
+		static thread_local uint32_t index = thread_count.fetch_add(1, std::memory_order_relaxed);
+		return index;
+#endif
+	}
+};
+
+// In thread-safe mode, get_or_null() and owns() don't lock: validators are read
+// atomically, and the chunk tables are allocated once for p_maximum_number_of_elements
+// so they never move. Freed indices go to one of several shards, picked per thread,
+// each with its own lock. Shards exchange batches of indices with a shared pool,
+// so memory freed by one thread can be reused by the others.
 template <typename T, bool THREAD_SAFE = false>
-class RID_Alloc {
+class RID_Alloc : public RID_AllocBase {
+	static constexpr uint32_t SHARD_COUNT = THREAD_SAFE ? 16 : 1;
+	// Amount of free indices moved between a shard and the shared pool at once.
+	static constexpr uint32_t FREE_BATCH_SIZE = 64;
+
+	// Padded by hand rather than with alignas(), which memnew doesn't honor,
+	// so the shards of different threads don't share a cache line.
+	struct Shard {
+		SpinLock lock;
+		LocalVector<uint32_t> free_list;
+		uint64_t next_validator = 0;
+		uint64_t validator_end = 0;
+		uint8_t padding[64];
+	};
+
 	T **chunks = nullptr;
-	uint32_t **free_list_chunks = nullptr;
-	uint32_t **validator_chunks = nullptr;
+	std::atomic<uint32_t> **validator_chunks = nullptr;
 
 	uint32_t elements_in_chunk;
-	uint32_t max_alloc = 0;
-	uint32_t alloc_count = 0;
+	uint32_t chunk_limit = 0;
+	std::atomic<uint32_t> max_alloc{ 0 };
+	std::atomic<uint32_t> alloc_count{ 0 };
 
 	const char *description = nullptr;
 
-	SpinLock spin_lock;
+	Shard shards[SHARD_COUNT];
+	LocalVector<uint32_t> free_pool;
+	SpinLock spin_lock; // Protects free_pool and the growth of the chunks.
 
-	_FORCE_INLINE_ RID _allocate_rid() {
+	_FORCE_INLINE_ Shard &_get_shard() {
+		if (SHARD_COUNT == 1) {
+			return shards[0];
+		}
+		return shards[_get_thread_index() % SHARD_COUNT];
+	}
+
+	_FORCE_INLINE_ std::atomic<uint32_t> &_get_validator(uint32_t p_index) {
+		return validator_chunks[p_index / elements_in_chunk][p_index % elements_in_chunk];
+	}
+
+	// Moves a batch of free indices to the shard, allocating a new chunk if there are none left.
+	bool _refill_shard(Shard &p_shard) {
 		if (THREAD_SAFE) {
 			spin_lock.lock();
 		}
 
-		if (alloc_count == max_alloc) {
-			// allocate a new chunk
-			uint32_t chunk_count = alloc_count == 0 ? 0 : (max_alloc / elements_in_chunk);
+		if (free_pool.is_empty()) {
+			uint32_t current_max = max_alloc.load(std::memory_order_relaxed);
+			uint32_t chunk_count = current_max / elements_in_chunk;
 
-			// grow chunks
-			chunks = (T **)memrealloc(chunks, sizeof(T *) * (chunk_count + 1));
-			chunks[chunk_count] = (T *)memalloc(sizeof(T) * elements_in_chunk); // but don't initialize
+			if (THREAD_SAFE) {
+				if (unlikely(chunk_count == chunk_limit)) {
+					spin_lock.unlock();
+					ERR_FAIL_V_MSG(false, "Element limit of the thread-safe RID_Alloc reached, raise p_maximum_number_of_elements.");
+				}
+			} else {
+				chunks = (T **)memrealloc(chunks, sizeof(T *) * (chunk_count + 1));
+				validator_chunks = (std::atomic<uint32_t> **)memrealloc(validator_chunks, sizeof(std::atomic<uint32_t> *) * (chunk_count + 1));
+			}
 
-			// grow validators
-			validator_chunks = (uint32_t **)memrealloc(validator_chunks, sizeof(uint32_t *) * (chunk_count + 1));
-			validator_chunks[chunk_count] = (uint32_t *)memalloc(sizeof(uint32_t) * elements_in_chunk);
-			// grow free lists
-			free_list_chunks = (uint32_t **)memrealloc(free_list_chunks, sizeof(uint32_t *) * (chunk_count + 1));
-			free_list_chunks[chunk_count] = (uint32_t *)memalloc(sizeof(uint32_t) * elements_in_chunk);
+			chunks[chunk_count] = (T *)memalloc(sizeof(T) * elements_in_chunk); // but don't initialize
+			std::atomic<uint32_t> *validators = (std::atomic<uint32_t> *)memalloc(sizeof(std::atomic<uint32_t>) * elements_in_chunk);
+			for (uint32_t i = 0; i < elements_in_chunk; i++) {
+				memnew_placement(&validators[i], std::atomic<uint32_t>(0xFFFFFFFF));
+			}
+			validator_chunks[chunk_count] = validators;
 
-			// initialize
+			// Lowest indices last, so they are allocated first.
+			free_pool.resize(elements_in_chunk);
 			for (uint32_t i = 0; i < elements_in_chunk; i++) {
-				// Don't initialize chunk.
-				validator_chunks[chunk_count][i] = 0xFFFFFFFF;
-				free_list_chunks[chunk_count][i] = alloc_count + i;
+				free_pool[i] = current_max + elements_in_chunk - i - 1;
 			}
 
-			max_alloc += elements_in_chunk;
+			// Lookups check the index against max_alloc before reading the chunk tables.
+			max_alloc.store(current_max + elements_in_chunk, std::memory_order_release);
+		}
+
+		const uint32_t count = MIN(FREE_BATCH_SIZE, free_pool.size());
+		const uint32_t from = free_pool.size() - count;
+		for (uint32_t i = 0; i < count; i++) {
+			p_shard.free_list.push_back(free_pool[from + i]);
+		}
+		free_pool.resize(from);
+
+		if (THREAD_SAFE) {
+			spin_lock.unlock();
+		}
+		return true;
+	}
+
+	_FORCE_INLINE_ RID _allocate_rid() {
+		Shard &shard = _get_shard();
+		if (THREAD_SAFE) {
+			shard.lock.lock();
+		}
+
+		if (unlikely(shard.free_list.is_empty()) && !_refill_shard(shard)) {
+			if (THREAD_SAFE) {
+				shard.lock.unlock();
+			}
+			return RID();
 		}
 
-		uint32_t free_index = free_list_chunks[alloc_count / elements_in_chunk][alloc_count % elements_in_chunk];
+		const uint32_t free_index = shard.free_list[shard.free_list.size() - 1];
+		shard.free_list.resize(shard.free_list.size() - 1);
+		const uint32_t validator = _next_validator(shard.next_validator, shard.validator_end);
 
-		uint32_t free_chunk = free_index / elements_in_chunk;
-		uint32_t free_element = free_index % elements_in_chunk;
+		// Still locked, so _lock_shards() waits for the RID to be visible.
+		_get_validator(free_index).store(validator | 0x80000000, std::memory_order_release); // mark uninitialized bit
+		alloc_count.fetch_add(1, std::memory_order_relaxed);
+
+		if (THREAD_SAFE) {
+			shard.lock.unlock();
+		}
 
-		uint32_t validator = (uint32_t)(UtilityFunctions::rid_allocate_id() & 0x7FFFFFFF);
 		uint64_t id = validator;
 		id <<= 32;
 		id |= free_index;
+		return _make_from_id(id);
+	}
+
+	// Returns the element of an allocated RID that wasn't initialized yet.
+	T *_get_uninitialized(const RID &p_rid, bool p_mark_initialized) {
+		uint64_t id = _get_id(p_rid);
+		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
+		if (unlikely(id == 0 || idx >= max_alloc.load(std::memory_order_acquire))) {
+			return nullptr;
+		}
 
-		validator_chunks[free_chunk][free_element] = validator;
+		uint32_t validator = uint32_t(id >> 32);
+		std::atomic<uint32_t> &current = _get_validator(idx);
+		uint32_t current_validator = current.load(std::memory_order_acquire);
 
-		validator_chunks[free_chunk][free_element] |= 0x80000000; // mark uninitialized bit
+		if (unlikely(!(current_validator & 0x80000000))) {
+			ERR_FAIL_V_MSG(nullptr, "Initializing already initialized RID");
+		}
+		if (unlikely((current_validator & 0x7FFFFFFF) != validator)) {
+			ERR_FAIL_V_MSG(nullptr, "Attempting to initialize the wrong RID");
+		}
+		if (p_mark_initialized && unlikely(!current.compare_exchange_strong(current_validator, validator, std::memory_order_acq_rel))) {
+			ERR_FAIL_V_MSG(nullptr, "Initializing already initialized RID");
+		}
 
-		alloc_count++;
+		return &chunks[idx / elements_in_chunk][idx % elements_in_chunk];
+	}
 
+	// Prevents allocations, for the functions that must not see new RIDs while they run.
+	// Frees can still happen meanwhile.
+	void _lock_shards() {
 		if (THREAD_SAFE) {
-			spin_lock.unlock();
+			for (uint32_t i = 0; i < SHARD_COUNT; i++) {
+				shards[i].lock.lock();
+			}
 		}
+	}
+
+	void _unlock_shards() {
+		if (THREAD_SAFE) {
+			for (uint32_t i = 0; i < SHARD_COUNT; i++) {
+				shards[i].lock.unlock();
+			}
+		}
+	}
 
-		return UtilityFunctions::rid_from_int64(id);
+	// Publishes an element constructed in the memory returned by _get_uninitialized().
+	void _mark_initialized(const RID &p_rid) {
+		uint64_t id = _get_id(p_rid);
+		_get_validator(uint32_t(id & 0xFFFFFFFF)).store(uint32_t(id >> 32), std::memory_order_release);
 	}
 
 public:
@@ -127,19 +289,13 @@ public:
 	}
 
 	_FORCE_INLINE_ T *get_or_null(const RID &p_rid, bool p_initialize = false) {
-		if (p_rid == RID()) {
-			return nullptr;
-		}
-		if (THREAD_SAFE) {
-			spin_lock.lock();
+		if (unlikely(p_initialize)) {
+			return _get_uninitialized(p_rid, true);
 		}
 
-		uint64_t id = p_rid.get_id();
+		uint64_t id = _get_id(p_rid);
 		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
-		if (unlikely(idx >= max_alloc)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
+		if (unlikely(id == 0 || idx >= max_alloc.load(std::memory_order_acquire))) {
 			return nullptr;
 		}
 
@@ -147,201 +303,186 @@ public:
 		uint32_t idx_element = idx % elements_in_chunk;
 
 		uint32_t validator = uint32_t(id >> 32);
+		uint32_t current_validator = validator_chunks[idx_chunk][idx_element].load(std::memory_order_acquire);
 
-		if (unlikely(p_initialize)) {
-			if (unlikely(!(validator_chunks[idx_chunk][idx_element] & 0x80000000))) {
-				if (THREAD_SAFE) {
-					spin_lock.unlock();
-				}
-				ERR_FAIL_V_MSG(nullptr, "Initializing already initialized RID");
-			}
-
-			if (unlikely((validator_chunks[idx_chunk][idx_element] & 0x7FFFFFFF) != validator)) {
-				if (THREAD_SAFE) {
-					spin_lock.unlock();
-				}
-				ERR_FAIL_V_MSG(nullptr, "Attempting to initialize the wrong RID");
-				return nullptr;
-			}
-
-			validator_chunks[idx_chunk][idx_element] &= 0x7FFFFFFF; // initialized
-
-		} else if (unlikely(validator_chunks[idx_chunk][idx_element] != validator)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
-			if ((validator_chunks[idx_chunk][idx_element] & 0x80000000) && validator_chunks[idx_chunk][idx_element] != 0xFFFFFFFF) {
+		if (unlikely(current_validator != validator)) {
+			if ((current_validator & 0x80000000) && current_validator != 0xFFFFFFFF) {
 				ERR_FAIL_V_MSG(nullptr, "Attempting to use an uninitialized RID");
 			}
 			return nullptr;
 		}
 
-		T *ptr = &chunks[idx_chunk][idx_element];
-
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
-
-		return ptr;
+		return &chunks[idx_chunk][idx_element];
 	}
 	void initialize_rid(RID p_rid) {
-		T *mem = get_or_null(p_rid, true);
+		T *mem = _get_uninitialized(p_rid, false);
 		ERR_FAIL_NULL(mem);
 		memnew_placement(mem, T);
+		_mark_initialized(p_rid);
 	}
 	void initialize_rid(RID p_rid, const T &p_value) {
-		T *mem = get_or_null(p_rid, true);
+		T *mem = _get_uninitialized(p_rid, false);
 		ERR_FAIL_NULL(mem);
 		memnew_placement(mem, T(p_value));
+		_mark_initialized(p_rid);
 	}
 
 	_FORCE_INLINE_ bool owns(const RID &p_rid) {
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
-
-		uint64_t id = p_rid.get_id();
+		uint64_t id = _get_id(p_rid);
 		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
-		if (unlikely(idx >= max_alloc)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
+		if (unlikely(idx >= max_alloc.load(std::memory_order_acquire))) {
 			return false;
 		}
 
-		uint32_t idx_chunk = idx / elements_in_chunk;
-		uint32_t idx_element = idx % elements_in_chunk;
-
 		uint32_t validator = uint32_t(id >> 32);
-
-		bool owned = (validator_chunks[idx_chunk][idx_element] & 0x7FFFFFFF) == validator;
-
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
-
-		return owned;
+		return (_get_validator(idx).load(std::memory_order_acquire) & 0x7FFFFFFF) == validator;
 	}
 
 	_FORCE_INLINE_ void free(const RID &p_rid) {
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
-
-		uint64_t id = p_rid.get_id();
+		uint64_t id = _get_id(p_rid);
 		uint32_t idx = uint32_t(id & 0xFFFFFFFF);
-		if (unlikely(idx >= max_alloc)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
+		if (unlikely(idx >= max_alloc.load(std::memory_order_acquire))) {
 			ERR_FAIL();
 		}
 
-		uint32_t idx_chunk = idx / elements_in_chunk;
-		uint32_t idx_element = idx % elements_in_chunk;
-
 		uint32_t validator = uint32_t(id >> 32);
-		if (unlikely(validator_chunks[idx_chunk][idx_element] & 0x80000000)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
+		std::atomic<uint32_t> &current = _get_validator(idx);
+		uint32_t current_validator = current.load(std::memory_order_acquire);
+		if (unlikely(current_validator & 0x80000000)) {
 			ERR_FAIL_MSG("Attempted to free an uninitialized or invalid RID");
-		} else if (unlikely(validator_chunks[idx_chunk][idx_element] != validator)) {
-			if (THREAD_SAFE) {
-				spin_lock.unlock();
-			}
+		} else if (unlikely(current_validator != validator)) {
 			ERR_FAIL();
 		}
 
-		chunks[idx_chunk][idx_element].~T();
-		validator_chunks[idx_chunk][idx_element] = 0xFFFFFFFF; // go invalid
-
-		alloc_count--;
-		free_list_chunks[alloc_count / elements_in_chunk][alloc_count % elements_in_chunk] = idx;
+		if (THREAD_SAFE) {
+			// Only one of several threads freeing the same RID gets to destroy it.
+			if (unlikely(!current.compare_exchange_strong(current_validator, 0xFFFFFFFF, std::memory_order_acq_rel))) {
+				ERR_FAIL();
+			}
+		} else {
+			current.store(0xFFFFFFFF, std::memory_order_relaxed); // go invalid
+		}
+		chunks[idx / elements_in_chunk][idx % elements_in_chunk].~T();
+		alloc_count.fetch_sub(1, std::memory_order_relaxed);
 
+		Shard &shard = _get_shard();
 		if (THREAD_SAFE) {
+			shard.lock.lock();
+		}
+		shard.free_list.push_back(idx);
+		if (THREAD_SAFE && unlikely(shard.free_list.size() > FREE_BATCH_SIZE * 2)) {
+			// Give a batch back, so the indices freed by this thread can be reused by the others.
+			const uint32_t from = shard.free_list.size() - FREE_BATCH_SIZE;
+			spin_lock.lock();
+			for (uint32_t i = 0; i < FREE_BATCH_SIZE; i++) {
+				free_pool.push_back(shard.free_list[from + i]);
+			}
 			spin_lock.unlock();
+			shard.free_list.resize(from);
+		}
+		if (THREAD_SAFE) {
+			shard.lock.unlock();
 		}
 	}
 
 	_FORCE_INLINE_ uint32_t get_rid_count() const {
-		return alloc_count;
+		return alloc_count.load(std::memory_order_relaxed);
 	}
 
 	void get_owned_list(List<RID> *p_owned) {
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
-		for (size_t i = 0; i < max_alloc; i++) {
-			uint64_t validator = validator_chunks[i / elements_in_chunk][i % elements_in_chunk];
+		_lock_shards();
+		const uint32_t count = max_alloc.load(std::memory_order_acquire);
+		for (size_t i = 0; i < count; i++) {
+			uint64_t validator = _get_validator(i).load(std::memory_order_acquire);
 			if (validator != 0xFFFFFFFF) {
-				p_owned->push_back(UtilityFunctions::rid_from_int64((validator << 32) | i));
+				p_owned->push_back(_make_from_id((validator << 32) | i));
 			}
 		}
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
+		_unlock_shards();
 	}
 
 	// used for fast iteration in the elements or RIDs
+	// The buffer must fit get_rid_count() RIDs, counted while no other thread allocates.
 	void fill_owned_buffer(RID *p_rid_buffer) {
-		if (THREAD_SAFE) {
-			spin_lock.lock();
-		}
+		fill_owned_buffer(p_rid_buffer, UINT32_MAX);
+	}
+
+	// Writes up to p_capacity RIDs and returns how many were written, for
+	// buffers sized while other threads can allocate.
+	uint32_t fill_owned_buffer(RID *p_rid_buffer, uint32_t p_capacity) {
+		_lock_shards();
+		const uint32_t count = max_alloc.load(std::memory_order_acquire);
 		uint32_t idx = 0;
-		for (size_t i = 0; i < max_alloc; i++) {
-			uint64_t validator = validator_chunks[i / elements_in_chunk][i % elements_in_chunk];
+		for (size_t i = 0; i < count && idx < p_capacity; i++) {
+			uint64_t validator = _get_validator(i).load(std::memory_order_acquire);
 			if (validator != 0xFFFFFFFF) {
-				p_rid_buffer[idx] = UtilityFunctions::rid_from_int64((validator << 32) | i);
+				p_rid_buffer[idx] = _make_from_id((validator << 32) | i);
 				idx++;
 			}
 		}
-		if (THREAD_SAFE) {
-			spin_lock.unlock();
-		}
+		_unlock_shards();
+		return idx;
 	}
 
 	void set_description(const char *p_descrption) {
 		description = p_descrption;
 	}
 
-	RID_Alloc(uint32_t p_target_chunk_byte_size = 65536) {
+#ifdef SPIN_LOCK_STATS_ENABLED
+	// Stats of the locks of every shard and of the shared pool, added together.
+	SpinLockStats get_lock_stats() const {
+		SpinLockStats total = spin_lock.get_stats();
+		for (uint32_t i = 0; i < SHARD_COUNT; i++) {
+			const SpinLockStats stats = shards[i].lock.get_stats();
+			total.acquisitions += stats.acquisitions;
+			total.contentions += stats.contentions;
+			total.spins += stats.spins;
+			total.max_wait_usec = MAX(total.max_wait_usec, stats.max_wait_usec);
+		}
+		return total;
+	}
+#endif
+
+	RID_Alloc(uint32_t p_target_chunk_byte_size = 65536, uint32_t p_maximum_number_of_elements = 262144) {
 		elements_in_chunk = sizeof(T) > p_target_chunk_byte_size ? 1 : (p_target_chunk_byte_size / sizeof(T));
+		if (THREAD_SAFE) {
+			chunk_limit = (p_maximum_number_of_elements + elements_in_chunk - 1) / elements_in_chunk;
+			chunks = (T **)memalloc(sizeof(T *) * chunk_limit);
+			validator_chunks = (std::atomic<uint32_t> **)memalloc(sizeof(std::atomic<uint32_t> *) * chunk_limit);
+		}
 	}
 
 	~RID_Alloc() {
-		if (alloc_count) {
+		const uint32_t count = alloc_count.load(std::memory_order_relaxed);
+		const uint32_t current_max = max_alloc.load(std::memory_order_relaxed);
+		if (count) {
 			if (description) {
-				printf("ERROR: %d  RID allocations of type '%s' were leaked at exit.", alloc_count, description);
+				printf("ERROR: %d  RID allocations of type '%s' were leaked at exit.", count, description);
 			} else {
 #ifdef NO_SAFE_CAST
-				printf("ERROR: %d RID allocations of type 'unknown' were leaked at exit.", alloc_count);
+				printf("ERROR: %d RID allocations of type 'unknown' were leaked at exit.", count);
 #else
-				printf("ERROR: %d RID allocations of type '%s' were leaked at exit.", alloc_count, typeid(T).name());
+				printf("ERROR: %d RID allocations of type '%s' were leaked at exit.", count, typeid(T).name());
 #endif
 			}
 
-			for (size_t i = 0; i < max_alloc; i++) {
-				uint64_t validator = validator_chunks[i / elements_in_chunk][i % elements_in_chunk];
+			for (size_t i = 0; i < current_max; i++) {
+				uint32_t validator = _get_validator(i).load(std::memory_order_relaxed);
 				if (validator & 0x80000000) {
 					continue; // uninitialized
 				}
-				if (validator != 0xFFFFFFFF) {
-					chunks[i / elements_in_chunk][i % elements_in_chunk].~T();
-				}
+				chunks[i / elements_in_chunk][i % elements_in_chunk].~T();
 			}
 		}
 
-		uint32_t chunk_count = max_alloc / elements_in_chunk;
+		uint32_t chunk_count = current_max / elements_in_chunk;
 		for (uint32_t i = 0; i < chunk_count; i++) {
 			memfree(chunks[i]);
 			memfree(validator_chunks[i]);
-			memfree(free_list_chunks[i]);
 		}
 
 		if (chunks) {
 			memfree(chunks);
-			memfree(free_list_chunks);
 			memfree(validator_chunks);
 		}
 	}
@@ -397,13 +538,22 @@ public:
 	void fill_owned_buffer(RID *p_rid_buffer) {
 		alloc.fill_owned_buffer(p_rid_buffer);
 	}
+	uint32_t fill_owned_buffer(RID *p_rid_buffer, uint32_t p_capacity) {
+		return alloc.fill_owned_buffer(p_rid_buffer, p_capacity);
+	}
 
 	void set_description(const char *p_descrption) {
 		alloc.set_description(p_descrption);
 	}
 
-	RID_PtrOwner(uint32_t p_target_chunk_byte_size = 65536) :
-			alloc(p_target_chunk_byte_size) {}
+#ifdef SPIN_LOCK_STATS_ENABLED
+	SpinLockStats get_lock_stats() const {
+		return alloc.get_lock_stats();
+	}
+#endif
+
+	RID_PtrOwner(uint32_t p_target_chunk_byte_size = 65536, uint32_t p_maximum_number_of_elements = 262144) :
+			alloc(p_target_chunk_byte_size, p_maximum_number_of_elements) {}
 };
 
 template <typename T, bool THREAD_SAFE = false>
@@ -452,12 +602,21 @@ public:
 	void fill_owned_buffer(RID *p_rid_buffer) {
 		alloc.fill_owned_buffer(p_rid_buffer);
 	}
+	uint32_t fill_owned_buffer(RID *p_rid_buffer, uint32_t p_capacity) {
+		return alloc.fill_owned_buffer(p_rid_buffer, p_capacity);
+	}
 
 	void set_description(const char *p_descrption) {
 		alloc.set_description(p_descrption);
 	}
-	RID_Owner(uint32_t p_target_chunk_byte_size = 65536) :
-			alloc(p_target_chunk_byte_size) {}
+
+#ifdef SPIN_LOCK_STATS_ENABLED
+	SpinLockStats get_lock_stats() const {
+		return alloc.get_lock_stats();
+	}
+#endif
+	RID_Owner(uint32_t p_target_chunk_byte_size = 65536, uint32_t p_maximum_number_of_elements = 262144) :
+			alloc(p_target_chunk_byte_size, p_maximum_number_of_elements) {}
 };
 
 } // namespace godot
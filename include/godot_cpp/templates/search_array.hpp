@@ -35,34 +35,93 @@
 
 namespace godot {
 
+// Branchless binary searches over sorted arrays. The range is halved a fixed
+// number of times for a given length, so the loop doesn't depend on the result
+// of the comparisons and there's nothing for the CPU to mispredict.
+//
+// The comparator may take a different type than T as the searched value, e.g.
+// a key for an array of key/value pairs: lower_bound() calls compare(element, value)
+// and upper_bound() calls compare(value, element).
 template <typename T, typename Comparator = _DefaultComparator<T>>
 class SearchArray {
+	// Amount of searches interleaved by the *_many() methods.
+	static constexpr int BATCH_SIZE = 16;
+
+	_FORCE_INLINE_ static void _prefetch(const T *p_ptr) {
+#if defined(__GNUC__)
+		__builtin_prefetch(p_ptr);
+#endif
+	}
+
 public:
 	Comparator compare;
 
-	inline int bisect(const T *p_array, int p_len, const T &p_value, bool p_before) const {
-		int lo = 0;
-		int hi = p_len;
-		if (p_before) {
-			while (lo < hi) {
-				const int mid = (lo + hi) / 2;
-				if (compare(p_array[mid], p_value)) {
-					lo = mid + 1;
-				} else {
-					hi = mid;
-				}
+	// Index of the first element that is not lower than p_value, or p_len.
+	template <typename V>
+	inline int lower_bound(const T *p_array, int p_len, const V &p_value) const {
+		if (p_len <= 0) {
+			return 0;
+		}
+		const T *base = p_array;
+		int len = p_len;
+		while (len > 1) {
+			const int half = len / 2;
+			base = compare(base[half], p_value) ? base + half : base;
+			len -= half;
+		}
+		return int(base - p_array) + int(compare(*base, p_value));
+	}
+
+	// Index of the first element that is greater than p_value, or p_len.
+	template <typename V>
+	inline int upper_bound(const T *p_array, int p_len, const V &p_value) const {
+		if (p_len <= 0) {
+			return 0;
+		}
+		const T *base = p_array;
+		int len = p_len;
+		while (len > 1) {
+			const int half = len / 2;
+			base = compare(p_value, base[half]) ? base : base + half;
+			len -= half;
+		}
+		return int(base - p_array) + int(!compare(p_value, *base));
+	}
+
+	// Same as calling lower_bound() for each of the p_count values, but searches
+	// for several values at once so their cache misses overlap. Each search also
+	// prefetches the element it will probe next, while the other ones progress.
+	template <typename V>
+	void lower_bound_many(const T *p_array, int p_len, const V *p_values, int p_count, int *r_indices) const {
+		for (int start = 0; start < p_count; start += BATCH_SIZE) {
+			const int count = p_count - start < BATCH_SIZE ? p_count - start : BATCH_SIZE;
+			const V *values = &p_values[start];
+			int *indices = &r_indices[start];
+			for (int i = 0; i < count; i++) {
+				indices[i] = 0;
 			}
-		} else {
-			while (lo < hi) {
-				const int mid = (lo + hi) / 2;
-				if (compare(p_value, p_array[mid])) {
-					hi = mid;
-				} else {
-					lo = mid + 1;
+			if (p_len <= 0) {
+				continue;
+			}
+
+			int len = p_len;
+			while (len > 1) {
+				const int half = len / 2;
+				const int next_half = (len - half) / 2;
+				for (int i = 0; i < count; i++) {
+					indices[i] += compare(p_array[indices[i] + half], values[i]) ? half : 0;
+					_prefetch(&p_array[indices[i] + next_half]);
 				}
+				len -= half;
+			}
+			for (int i = 0; i < count; i++) {
+				indices[i] += int(compare(p_array[indices[i]], values[i]));
 			}
 		}
-		return lo;
+	}
+
+	inline int bisect(const T *p_array, int p_len, const T &p_value, bool p_before) const {
+		return p_before ? lower_bound(p_array, p_len, p_value) : upper_bound(p_array, p_len, p_value);
 	}
 };
 
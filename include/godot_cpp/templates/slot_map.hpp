@@ -0,0 +1,244 @@
+/**************************************************************************/
+/*  slot_map.hpp                                                          */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_SLOT_MAP_HPP
+#define GODOT_SLOT_MAP_HPP
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+
+#include <utility>
+
+namespace godot {
+
+// Handle to a value in a SlotMap: a slot index and the generation of the slot
+// when the value was inserted. A default constructed handle is null.
+struct SlotMapHandle {
+	uint64_t id = 0;
+
+	_FORCE_INLINE_ uint32_t get_index() const { return uint32_t(id & 0xFFFFFFFF); }
+	_FORCE_INLINE_ uint32_t get_generation() const { return uint32_t(id >> 32); }
+	_FORCE_INLINE_ uint64_t get_id() const { return id; }
+	_FORCE_INLINE_ bool is_null() const { return id == 0; }
+	_FORCE_INLINE_ bool is_valid() const { return id != 0; }
+
+	_FORCE_INLINE_ bool operator==(const SlotMapHandle &p_other) const { return id == p_other.id; }
+	_FORCE_INLINE_ bool operator!=(const SlotMapHandle &p_other) const { return id != p_other.id; }
+	_FORCE_INLINE_ bool operator<(const SlotMapHandle &p_other) const { return id < p_other.id; }
+
+	_FORCE_INLINE_ SlotMapHandle() {}
+	_FORCE_INLINE_ explicit SlotMapHandle(uint64_t p_id) :
+			id(p_id) {}
+	_FORCE_INLINE_ SlotMapHandle(uint32_t p_index, uint32_t p_generation) :
+			id((uint64_t(p_generation) << 32) | p_index) {}
+};
+
+// Stores values packed in a contiguous array, addressed through generational
+// handles. Handles of removed values become invalid, even if their slot is reused.
+//
+// Removing a value moves the last one into its place, so iterating with
+// begin()/end(), ptr() or for_each() only ever visits live values, in no
+// particular order. For the same reason, pointers to values are invalidated
+// by insert() and remove(), handles are not.
+//
+// Unlike RID_Owner, it is not thread-safe and makes no engine calls.
+template <typename T>
+class SlotMap {
+	struct Slot {
+		// Odd while the slot holds a value, incremented on insert and remove.
+		uint32_t generation = 0;
+		// Index of the value in `values` while in use, next free slot otherwise.
+		uint32_t index = 0;
+	};
+
+	static constexpr uint32_t INVALID_SLOT = 0xFFFFFFFF;
+
+	LocalVector<T> values;
+	LocalVector<uint32_t> value_slots; // Slot of each value.
+	LocalVector<Slot> slots;
+	uint32_t free_slot = INVALID_SLOT;
+
+	_FORCE_INLINE_ const Slot *_get_slot(const SlotMapHandle &p_handle) const {
+		const uint32_t index = p_handle.get_index();
+		if (unlikely(index >= slots.size())) {
+			return nullptr;
+		}
+		const Slot *slot = &slots.ptr()[index];
+		// Free slots have an even generation, which no handle has.
+		if (unlikely(slot->generation != p_handle.get_generation() || !(slot->generation & 1))) {
+			return nullptr;
+		}
+		return slot;
+	}
+
+	SlotMapHandle _allocate_slot() {
+		uint32_t slot_index = free_slot;
+		if (slot_index == INVALID_SLOT) {
+			slot_index = slots.size();
+			slots.push_back(Slot());
+		} else {
+			free_slot = slots[slot_index].index;
+		}
+
+		Slot &slot = slots[slot_index];
+		slot.generation++;
+		slot.index = values.size();
+		value_slots.push_back(slot_index);
+		return SlotMapHandle(slot_index, slot.generation);
+	}
+
+public:
+	SlotMapHandle insert(const T &p_value) {
+		SlotMapHandle handle = _allocate_slot();
+		values.push_back(p_value);
+		return handle;
+	}
+
+	SlotMapHandle insert() {
+		return insert(T());
+	}
+
+	_FORCE_INLINE_ T *get_or_null(const SlotMapHandle &p_handle) {
+		const Slot *slot = _get_slot(p_handle);
+		return slot ? &values.ptr()[slot->index] : nullptr;
+	}
+
+	_FORCE_INLINE_ const T *get_or_null(const SlotMapHandle &p_handle) const {
+		const Slot *slot = _get_slot(p_handle);
+		return slot ? &values.ptr()[slot->index] : nullptr;
+	}
+
+	_FORCE_INLINE_ bool has(const SlotMapHandle &p_handle) const {
+		return _get_slot(p_handle) != nullptr;
+	}
+
+	const T &operator[](const SlotMapHandle &p_handle) const {
+		const T *value = get_or_null(p_handle);
+		CRASH_COND(!value);
+		return *value;
+	}
+
+	T &operator[](const SlotMapHandle &p_handle) {
+		T *value = get_or_null(p_handle);
+		CRASH_COND(!value);
+		return *value;
+	}
+
+	bool remove(const SlotMapHandle &p_handle) {
+		const Slot *found = _get_slot(p_handle);
+		if (!found) {
+			return false;
+		}
+
+		const uint32_t slot_index = p_handle.get_index();
+		const uint32_t index = found->index;
+		const uint32_t last = values.size() - 1;
+		if (index != last) {
+			values[index] = std::move(values[last]);
+			value_slots[index] = value_slots[last];
+			slots[value_slots[index]].index = index;
+		}
+		values.resize(last);
+		value_slots.resize(last);
+
+		Slot &slot = slots[slot_index];
+		slot.generation++;
+		slot.index = free_slot;
+		free_slot = slot_index;
+		return true;
+	}
+
+	// Handle of the value at p_index in the packed array, e.g. while iterating with ptr().
+	_FORCE_INLINE_ SlotMapHandle get_handle(uint32_t p_index) const {
+		ERR_FAIL_UNSIGNED_INDEX_V(p_index, values.size(), SlotMapHandle());
+		const uint32_t slot_index = value_slots[p_index];
+		return SlotMapHandle(slot_index, slots[slot_index].generation);
+	}
+
+	// Index of the value in the packed array, or -1. Only valid until the next remove().
+	_FORCE_INLINE_ int64_t get_index(const SlotMapHandle &p_handle) const {
+		const Slot *slot = _get_slot(p_handle);
+		return slot ? int64_t(slot->index) : -1;
+	}
+
+	// Calls p_func(value) on every value.
+	template <typename F>
+	void for_each(F p_func) {
+		T *ptr = values.ptr();
+		const uint32_t count = values.size();
+		for (uint32_t i = 0; i < count; i++) {
+			p_func(ptr[i]);
+		}
+	}
+
+	template <typename F>
+	void for_each(F p_func) const {
+		const T *ptr = values.ptr();
+		const uint32_t count = values.size();
+		for (uint32_t i = 0; i < count; i++) {
+			p_func(ptr[i]);
+		}
+	}
+
+	_FORCE_INLINE_ T *ptr() { return values.ptr(); }
+	_FORCE_INLINE_ const T *ptr() const { return values.ptr(); }
+
+	_FORCE_INLINE_ T *begin() { return values.ptr(); }
+	_FORCE_INLINE_ T *end() { return values.ptr() + values.size(); }
+	_FORCE_INLINE_ const T *begin() const { return values.ptr(); }
+	_FORCE_INLINE_ const T *end() const { return values.ptr() + values.size(); }
+
+	_FORCE_INLINE_ uint32_t size() const { return values.size(); }
+	_FORCE_INLINE_ bool is_empty() const { return values.is_empty(); }
+
+	void reserve(uint32_t p_size) {
+		values.reserve(p_size);
+		value_slots.reserve(p_size);
+		slots.reserve(p_size);
+	}
+
+	// Removes every value. Slots are kept, so handles from before stay invalid.
+	void clear() {
+		for (uint32_t i = 0; i < value_slots.size(); i++) {
+			Slot &slot = slots[value_slots[i]];
+			slot.generation++;
+			slot.index = free_slot;
+			free_slot = value_slots[i];
+		}
+		values.clear();
+		value_slots.clear();
+	}
+
+	SlotMap() {}
+};
+
+} // namespace godot
+
+#endif // GODOT_SLOT_MAP_HPP
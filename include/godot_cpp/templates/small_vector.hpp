@@ -0,0 +1,394 @@
+/**************************************************************************/
+/*  small_vector.hpp                                                      */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_SMALL_VECTOR_HPP
+#define GODOT_SMALL_VECTOR_HPP
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/memory.hpp>
+#include <godot_cpp/templates/sort_array.hpp>
+#include <godot_cpp/templates/vector.hpp>
+
+#include <initializer_list>
+#include <type_traits>
+
+namespace godot {
+
+// Same as LocalVector, but the first N elements are stored inside the object,
+// so vectors that never grow past N elements don't allocate memory at all.
+// Once it grows past N, the elements move to the heap (and stay there until reset()).
+//
+// Like LocalVector, elements are relocated with a plain memory copy when the
+// storage changes. The vector doesn't point into itself, so it can be relocated
+// the same way, e.g. as an element of LocalVector or Vector.
+template <typename T, uint32_t N, typename U = uint32_t, bool force_trivial = false, bool tight = false>
+class SmallVector {
+	static_assert(N > 0, "SmallVector needs an inline capacity, use LocalVector otherwise.");
+
+private:
+	U count = 0;
+	U capacity = N;
+	T *heap = nullptr; // `nullptr` while the elements are inline.
+	alignas(T) uint8_t inline_data[N * sizeof(T)];
+
+	_FORCE_INLINE_ bool _is_inline() const { return heap == nullptr; }
+
+	void _realloc_data(U p_capacity) {
+		if (_is_inline()) {
+			T *mem = (T *)memalloc(p_capacity * sizeof(T));
+			CRASH_COND_MSG(!mem, "Out of memory");
+			memcpy((void *)mem, (const void *)inline_data, count * sizeof(T));
+			heap = mem;
+		} else {
+			heap = (T *)memrealloc(heap, p_capacity * sizeof(T));
+			CRASH_COND_MSG(!heap, "Out of memory");
+		}
+	}
+
+	// Steals the storage of p_from, leaving it empty.
+	void _move_from(SmallVector &p_from) {
+		if (p_from._is_inline()) {
+			memcpy((void *)inline_data, (const void *)p_from.inline_data, p_from.count * sizeof(T));
+		} else {
+			heap = p_from.heap;
+			capacity = p_from.capacity;
+		}
+		count = p_from.count;
+		p_from.heap = nullptr;
+		p_from.count = 0;
+		p_from.capacity = N;
+	}
+
+public:
+	_FORCE_INLINE_ T *ptr() {
+		return heap ? heap : (T *)inline_data;
+	}
+
+	_FORCE_INLINE_ const T *ptr() const {
+		return heap ? heap : (const T *)inline_data;
+	}
+
+	_FORCE_INLINE_ void push_back(T p_elem) {
+		if (unlikely(count == capacity)) {
+			capacity <<= 1;
+			_realloc_data(capacity);
+		}
+
+		T *data = ptr();
+		if constexpr (!std::is_trivially_constructible<T>::value && !force_trivial) {
+			memnew_placement(&data[count++], T(p_elem));
+		} else {
+			data[count++] = p_elem;
+		}
+	}
+
+	void remove_at(U p_index) {
+		ERR_FAIL_UNSIGNED_INDEX(p_index, count);
+		T *data = ptr();
+		count--;
+		for (U i = p_index; i < count; i++) {
+			data[i] = data[i + 1];
+		}
+		if constexpr (!std::is_trivially_destructible<T>::value && !force_trivial) {
+			data[count].~T();
+		}
+	}
+
+	/// Removes the item copying the last value into the position of the one to
+	/// remove. It's generally faster than `remove`.
+	void remove_at_unordered(U p_index) {
+		ERR_FAIL_INDEX(p_index, count);
+		T *data = ptr();
+		count--;
+		if (count > p_index) {
+			data[p_index] = data[count];
+		}
+		if constexpr (!std::is_trivially_destructible<T>::value && !force_trivial) {
+			data[count].~T();
+		}
+	}
+
+	void erase(const T &p_val) {
+		int64_t idx = find(p_val);
+		if (idx >= 0) {
+			remove_at(idx);
+		}
+	}
+
+	void invert() {
+		T *data = ptr();
+		for (U i = 0; i < count / 2; i++) {
+			SWAP(data[i], data[count - i - 1]);
+		}
+	}
+
+	_FORCE_INLINE_ void clear() { resize(0); }
+	// Also releases the heap memory, going back to the inline storage.
+	_FORCE_INLINE_ void reset() {
+		clear();
+		if (!_is_inline()) {
+			memfree(heap);
+			heap = nullptr;
+			capacity = N;
+		}
+	}
+	_FORCE_INLINE_ bool is_empty() const { return count == 0; }
+	_FORCE_INLINE_ bool is_inline() const { return _is_inline(); }
+	_FORCE_INLINE_ U get_capacity() const { return capacity; }
+	_FORCE_INLINE_ static constexpr U get_inline_capacity() { return N; }
+	_FORCE_INLINE_ void reserve(U p_size) {
+		p_size = tight ? p_size : nearest_power_of_2_templated(p_size);
+		if (p_size > capacity) {
+			capacity = p_size;
+			_realloc_data(capacity);
+		}
+	}
+
+	_FORCE_INLINE_ U size() const { return count; }
+	void resize(U p_size) {
+		if (p_size < count) {
+			if constexpr (!std::is_trivially_destructible<T>::value && !force_trivial) {
+				T *data = ptr();
+				for (U i = p_size; i < count; i++) {
+					data[i].~T();
+				}
+			}
+			count = p_size;
+		} else if (p_size > count) {
+			if (unlikely(p_size > capacity)) {
+				while (capacity < p_size) {
+					capacity <<= 1;
+				}
+				_realloc_data(capacity);
+			}
+			if constexpr (!std::is_trivially_constructible<T>::value && !force_trivial) {
+				T *data = ptr();
+				for (U i = count; i < p_size; i++) {
+					memnew_placement(&data[i], T);
+				}
+			}
+			count = p_size;
+		}
+	}
+	_FORCE_INLINE_ const T &operator[](U p_index) const {
+		CRASH_BAD_UNSIGNED_INDEX(p_index, count);
+		return ptr()[p_index];
+	}
+	_FORCE_INLINE_ T &operator[](U p_index) {
+		CRASH_BAD_UNSIGNED_INDEX(p_index, count);
+		return ptr()[p_index];
+	}
+
+	struct Iterator {
+		_FORCE_INLINE_ T &operator*() const {
+			return *elem_ptr;
+		}
+		_FORCE_INLINE_ T *operator->() const { return elem_ptr; }
+		_FORCE_INLINE_ Iterator &operator++() {
+			elem_ptr++;
+			return *this;
+		}
+		_FORCE_INLINE_ Iterator &operator--() {
+			elem_ptr--;
+			return *this;
+		}
+
+		_FORCE_INLINE_ bool operator==(const Iterator &b) const { return elem_ptr == b.elem_ptr; }
+		_FORCE_INLINE_ bool operator!=(const Iterator &b) const { return elem_ptr != b.elem_ptr; }
+
+		Iterator(T *p_ptr) { elem_ptr = p_ptr; }
+		Iterator() {}
+		Iterator(const Iterator &p_it) { elem_ptr = p_it.elem_ptr; }
+
+	private:
+		T *elem_ptr = nullptr;
+	};
+
+	struct ConstIterator {
+		_FORCE_INLINE_ const T &operator*() const {
+			return *elem_ptr;
+		}
+		_FORCE_INLINE_ const T *operator->() const { return elem_ptr; }
+		_FORCE_INLINE_ ConstIterator &operator++() {
+			elem_ptr++;
+			return *this;
+		}
+		_FORCE_INLINE_ ConstIterator &operator--() {
+			elem_ptr--;
+			return *this;
+		}
+
+		_FORCE_INLINE_ bool operator==(const ConstIterator &b) const { return elem_ptr == b.elem_ptr; }
+		_FORCE_INLINE_ bool operator!=(const ConstIterator &b) const { return elem_ptr != b.elem_ptr; }
+
+		ConstIterator(const T *p_ptr) { elem_ptr = p_ptr; }
+		ConstIterator() {}
+		ConstIterator(const ConstIterator &p_it) { elem_ptr = p_it.elem_ptr; }
+
+	private:
+		const T *elem_ptr = nullptr;
+	};
+
+	_FORCE_INLINE_ Iterator begin() {
+		return Iterator(ptr());
+	}
+	_FORCE_INLINE_ Iterator end() {
+		return Iterator(ptr() + size());
+	}
+
+	_FORCE_INLINE_ ConstIterator begin() const {
+		return ConstIterator(ptr());
+	}
+	_FORCE_INLINE_ ConstIterator end() const {
+		return ConstIterator(ptr() + size());
+	}
+
+	void insert(U p_pos, T p_val) {
+		ERR_FAIL_UNSIGNED_INDEX(p_pos, count + 1);
+		if (p_pos == count) {
+			push_back(p_val);
+		} else {
+			resize(count + 1);
+			T *data = ptr();
+			for (U i = count - 1; i > p_pos; i--) {
+				data[i] = data[i - 1];
+			}
+			data[p_pos] = p_val;
+		}
+	}
+
+	int64_t find(const T &p_val, U p_from = 0) const {
+		const T *data = ptr();
+		for (U i = p_from; i < count; i++) {
+			if (data[i] == p_val) {
+				return int64_t(i);
+			}
+		}
+		return -1;
+	}
+
+	bool has(const T &p_val) const {
+		return find(p_val) != -1;
+	}
+
+	template <typename C>
+	void sort_custom() {
+		U len = count;
+		if (len == 0) {
+			return;
+		}
+
+		SortArray<T, C> sorter;
+		sorter.sort(ptr(), len);
+	}
+
+	void sort() {
+		sort_custom<_DefaultComparator<T>>();
+	}
+
+	void ordered_insert(T p_val) {
+		const T *data = ptr();
+		U i;
+		for (i = 0; i < count; i++) {
+			if (p_val < data[i]) {
+				break;
+			}
+		}
+		insert(i, p_val);
+	}
+
+	operator Vector<T>() const {
+		Vector<T> ret;
+		ret.resize(size());
+		T *w = ret.ptrw();
+		memcpy(w, ptr(), sizeof(T) * count);
+		return ret;
+	}
+
+	Vector<uint8_t> to_byte_array() const { //useful to pass stuff to gpu or variant
+		Vector<uint8_t> ret;
+		ret.resize(count * sizeof(T));
+		uint8_t *w = ret.ptrw();
+		memcpy(w, ptr(), sizeof(T) * count);
+		return ret;
+	}
+
+	_FORCE_INLINE_ SmallVector() {}
+	_FORCE_INLINE_ SmallVector(std::initializer_list<T> p_init) {
+		reserve(p_init.size());
+		for (const T &element : p_init) {
+			push_back(element);
+		}
+	}
+	_FORCE_INLINE_ SmallVector(const SmallVector &p_from) {
+		resize(p_from.size());
+		T *data = ptr();
+		const T *from = p_from.ptr();
+		for (U i = 0; i < p_from.count; i++) {
+			data[i] = from[i];
+		}
+	}
+	_FORCE_INLINE_ SmallVector(SmallVector &&p_from) {
+		_move_from(p_from);
+	}
+	inline void operator=(const SmallVector &p_from) {
+		resize(p_from.size());
+		T *data = ptr();
+		const T *from = p_from.ptr();
+		for (U i = 0; i < p_from.count; i++) {
+			data[i] = from[i];
+		}
+	}
+	inline void operator=(SmallVector &&p_from) {
+		if (this == &p_from) {
+			return;
+		}
+		reset();
+		_move_from(p_from);
+	}
+	inline void operator=(const Vector<T> &p_from) {
+		resize(p_from.size());
+		T *data = ptr();
+		for (U i = 0; i < count; i++) {
+			data[i] = p_from[i];
+		}
+	}
+
+	_FORCE_INLINE_ ~SmallVector() {
+		reset();
+	}
+};
+
+template <typename T, uint32_t N, typename U = uint32_t, bool force_trivial = false>
+using TightSmallVector = SmallVector<T, N, U, force_trivial, true>;
+
+} // namespace godot
+
+#endif // GODOT_SMALL_VECTOR_HPP
@@ -31,21 +31,344 @@
 #ifndef GODOT_SPIN_LOCK_HPP
 #define GODOT_SPIN_LOCK_HPP
 
+#include <godot_cpp/core/defs.hpp>
+
 #include <atomic>
+#include <cstdint>
+#include <thread>
+
+#ifdef SPIN_LOCK_STATS_ENABLED
+#include <chrono>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace godot {
 
+// Tells the CPU the thread is busy waiting, which saves power and leaves
+// the execution resources to the other hyperthread of the core.
+_ALWAYS_INLINE_ void _cpu_pause() {
+#if defined(_MSC_VER)
+#if defined(_M_ARM) || defined(_M_ARM64)
+	__yield();
+#elif defined(_M_IX86) || defined(_M_X64)
+	_mm_pause();
+#endif
+#elif defined(__GNUC__) || defined(__clang__)
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+	asm volatile("yield");
+#elif defined(__powerpc__) || defined(__ppc__) || defined(__PPC__)
+	asm volatile("or 27,27,27");
+#elif defined(__riscv)
+	asm volatile(".insn i 0x0F, 0, x0, x0, 0x010");
+#endif
+#endif
+}
+
+// Exponential backoff for busy waiting: each pause() spins twice as long as
+// the previous one, until it gives the rest of its time slice to the OS instead.
+class SpinBackoff {
+	static constexpr uint32_t MAX_PAUSES = 64;
+	uint32_t pauses = 1;
+
+public:
+	_ALWAYS_INLINE_ void pause() {
+		if (pauses <= MAX_PAUSES) {
+			for (uint32_t i = 0; i < pauses; i++) {
+				_cpu_pause();
+			}
+			pauses <<= 1;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+};
+
+// Counters kept by each lock when building with `use_spin_lock_stats=yes`
+// (SPIN_LOCK_STATS_ENABLED). Updated by the thread holding the lock.
+struct SpinLockStats {
+	uint64_t acquisitions = 0;
+	uint64_t contentions = 0; // Acquisitions that had to wait.
+	uint64_t spins = 0; // Backoff rounds spent waiting, in total.
+	uint64_t max_wait_usec = 0;
+};
+
+#ifdef SPIN_LOCK_STATS_ENABLED
+class _SpinLockStatsCounter {
+	std::atomic<uint64_t> acquisitions{ 0 };
+	std::atomic<uint64_t> contentions{ 0 };
+	std::atomic<uint64_t> spins{ 0 };
+	std::atomic<uint64_t> max_wait_usec{ 0 };
+
+	_ALWAYS_INLINE_ static void _add(std::atomic<uint64_t> &p_counter, uint64_t p_value) {
+		p_counter.store(p_counter.load(std::memory_order_relaxed) + p_value, std::memory_order_relaxed);
+	}
+
+public:
+	typedef std::chrono::steady_clock::time_point TimePoint;
+
+	_ALWAYS_INLINE_ static TimePoint now() { return std::chrono::steady_clock::now(); }
+
+	// Must be called while holding the lock, stats are only read with relaxed loads.
+	_ALWAYS_INLINE_ void record(uint64_t p_spins, const TimePoint &p_wait_start) {
+		_add(acquisitions, 1);
+		if (p_spins) {
+			_add(contentions, 1);
+			_add(spins, p_spins);
+			const uint64_t wait = std::chrono::duration_cast<std::chrono::microseconds>(now() - p_wait_start).count();
+			if (wait > max_wait_usec.load(std::memory_order_relaxed)) {
+				max_wait_usec.store(wait, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Shared locks are held by several threads at once, so readers count atomically.
+	_ALWAYS_INLINE_ void record_shared(uint64_t p_spins, const TimePoint &p_wait_start) {
+		acquisitions.fetch_add(1, std::memory_order_relaxed);
+		if (p_spins) {
+			contentions.fetch_add(1, std::memory_order_relaxed);
+			spins.fetch_add(p_spins, std::memory_order_relaxed);
+			const uint64_t wait = std::chrono::duration_cast<std::chrono::microseconds>(now() - p_wait_start).count();
+			uint64_t current = max_wait_usec.load(std::memory_order_relaxed);
+			while (wait > current && !max_wait_usec.compare_exchange_weak(current, wait, std::memory_order_relaxed)) {
+			}
+		}
+	}
+
+	SpinLockStats get() const {
+		SpinLockStats stats;
+		stats.acquisitions = acquisitions.load(std::memory_order_relaxed);
+		stats.contentions = contentions.load(std::memory_order_relaxed);
+		stats.spins = spins.load(std::memory_order_relaxed);
+		stats.max_wait_usec = max_wait_usec.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	void reset() {
+		acquisitions.store(0, std::memory_order_relaxed);
+		contentions.store(0, std::memory_order_relaxed);
+		spins.store(0, std::memory_order_relaxed);
+		max_wait_usec.store(0, std::memory_order_relaxed);
+	}
+};
+#endif
+
 class SpinLock {
-	std::atomic_flag locked = ATOMIC_FLAG_INIT;
+	std::atomic<bool> locked{ false };
+#ifdef SPIN_LOCK_STATS_ENABLED
+	_SpinLockStatsCounter stats;
+#endif
 
 public:
 	_ALWAYS_INLINE_ void lock() {
-		while (locked.test_and_set(std::memory_order_acquire)) {
-			;
+		if (likely(!locked.exchange(true, std::memory_order_acquire))) {
+#ifdef SPIN_LOCK_STATS_ENABLED
+			stats.record(0, _SpinLockStatsCounter::TimePoint());
+#endif
+			return;
+		}
+		_lock_contended();
+	}
+	_ALWAYS_INLINE_ bool try_lock() {
+		// Reading first doesn't take the cache line away from the owner when it's locked.
+		if (locked.load(std::memory_order_relaxed) || locked.exchange(true, std::memory_order_acquire)) {
+			return false;
 		}
+#ifdef SPIN_LOCK_STATS_ENABLED
+		stats.record(0, _SpinLockStatsCounter::TimePoint());
+#endif
+		return true;
 	}
 	_ALWAYS_INLINE_ void unlock() {
-		locked.clear(std::memory_order_release);
+		locked.store(false, std::memory_order_release);
+	}
+
+#ifdef SPIN_LOCK_STATS_ENABLED
+	SpinLockStats get_stats() const { return stats.get(); }
+	void reset_stats() { stats.reset(); }
+#endif
+
+private:
+	void _lock_contended() {
+#ifdef SPIN_LOCK_STATS_ENABLED
+		const _SpinLockStatsCounter::TimePoint wait_start = _SpinLockStatsCounter::now();
+		uint64_t spins = 0;
+#endif
+		SpinBackoff backoff;
+		do {
+			// Wait for the lock to look free before trying to write to it again.
+			while (locked.load(std::memory_order_relaxed)) {
+				backoff.pause();
+#ifdef SPIN_LOCK_STATS_ENABLED
+				spins++;
+#endif
+			}
+		} while (locked.exchange(true, std::memory_order_acquire));
+#ifdef SPIN_LOCK_STATS_ENABLED
+		stats.record(spins > 0 ? spins : 1, wait_start);
+#endif
+	}
+};
+
+// Reader/writer spin lock for data that is read much more often than written.
+// Any amount of readers can hold it at once. A writer waiting for the lock
+// stops new readers from entering, so writers aren't starved by readers.
+class RWSpinLock {
+	static constexpr uint32_t WRITER = 0x80000000;
+	std::atomic<uint32_t> state{ 0 }; // Reader count, and whether a writer holds or waits for the lock.
+#ifdef SPIN_LOCK_STATS_ENABLED
+	_SpinLockStatsCounter read_stats;
+	_SpinLockStatsCounter write_stats;
+#endif
+
+public:
+	_ALWAYS_INLINE_ void read_lock() {
+		uint32_t current = state.load(std::memory_order_relaxed);
+		if (likely(!(current & WRITER)) && state.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+#ifdef SPIN_LOCK_STATS_ENABLED
+			read_stats.record_shared(0, _SpinLockStatsCounter::TimePoint());
+#endif
+			return;
+		}
+		_read_lock_contended();
+	}
+	_ALWAYS_INLINE_ bool try_read_lock() {
+		uint32_t current = state.load(std::memory_order_relaxed);
+		while (!(current & WRITER)) {
+			if (state.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+#ifdef SPIN_LOCK_STATS_ENABLED
+				read_stats.record_shared(0, _SpinLockStatsCounter::TimePoint());
+#endif
+				return true;
+			}
+		}
+		return false;
+	}
+	_ALWAYS_INLINE_ void read_unlock() {
+		state.fetch_sub(1, std::memory_order_release);
+	}
+
+	_ALWAYS_INLINE_ void write_lock() {
+		uint32_t expected = 0;
+		if (likely(state.compare_exchange_strong(expected, WRITER, std::memory_order_acquire, std::memory_order_relaxed))) {
+#ifdef SPIN_LOCK_STATS_ENABLED
+			write_stats.record(0, _SpinLockStatsCounter::TimePoint());
+#endif
+			return;
+		}
+		_write_lock_contended();
+	}
+	_ALWAYS_INLINE_ bool try_write_lock() {
+		uint32_t expected = 0;
+		if (!state.compare_exchange_strong(expected, WRITER, std::memory_order_acquire, std::memory_order_relaxed)) {
+			return false;
+		}
+#ifdef SPIN_LOCK_STATS_ENABLED
+		write_stats.record(0, _SpinLockStatsCounter::TimePoint());
+#endif
+		return true;
+	}
+	_ALWAYS_INLINE_ void write_unlock() {
+		state.store(0, std::memory_order_release);
+	}
+
+#ifdef SPIN_LOCK_STATS_ENABLED
+	SpinLockStats get_read_stats() const { return read_stats.get(); }
+	SpinLockStats get_write_stats() const { return write_stats.get(); }
+	void reset_stats() {
+		read_stats.reset();
+		write_stats.reset();
+	}
+#endif
+
+private:
+	void _read_lock_contended() {
+#ifdef SPIN_LOCK_STATS_ENABLED
+		const _SpinLockStatsCounter::TimePoint wait_start = _SpinLockStatsCounter::now();
+		uint64_t spins = 1;
+#endif
+		SpinBackoff backoff;
+		uint32_t current = state.load(std::memory_order_relaxed);
+		while (true) {
+			if (!(current & WRITER)) {
+				if (state.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+					break;
+				}
+				continue; // Another reader got in first, retry right away.
+			}
+			backoff.pause();
+#ifdef SPIN_LOCK_STATS_ENABLED
+			spins++;
+#endif
+			current = state.load(std::memory_order_relaxed);
+		}
+#ifdef SPIN_LOCK_STATS_ENABLED
+		read_stats.record_shared(spins, wait_start);
+#endif
+	}
+
+	void _write_lock_contended() {
+#ifdef SPIN_LOCK_STATS_ENABLED
+		const _SpinLockStatsCounter::TimePoint wait_start = _SpinLockStatsCounter::now();
+		uint64_t spins = 1;
+#endif
+		SpinBackoff backoff;
+		// Claim the writer bit first, so no new readers get in.
+		uint32_t current = state.load(std::memory_order_relaxed);
+		while (true) {
+			if (!(current & WRITER)) {
+				if (state.compare_exchange_weak(current, current | WRITER, std::memory_order_relaxed, std::memory_order_relaxed)) {
+					break;
+				}
+				continue;
+			}
+			backoff.pause();
+#ifdef SPIN_LOCK_STATS_ENABLED
+			spins++;
+#endif
+			current = state.load(std::memory_order_relaxed);
+		}
+		// Then wait for the readers inside to leave.
+		SpinBackoff drain_backoff;
+		while (state.load(std::memory_order_acquire) != WRITER) {
+			drain_backoff.pause();
+#ifdef SPIN_LOCK_STATS_ENABLED
+			spins++;
+#endif
+		}
+#ifdef SPIN_LOCK_STATS_ENABLED
+		write_stats.record(spins, wait_start);
+#endif
+	}
+};
+
+class RWSpinLockRead {
+	RWSpinLock &lock;
+
+public:
+	_ALWAYS_INLINE_ explicit RWSpinLockRead(RWSpinLock &p_lock) :
+			lock(p_lock) {
+		lock.read_lock();
+	}
+	_ALWAYS_INLINE_ ~RWSpinLockRead() {
+		lock.read_unlock();
+	}
+};
+
+class RWSpinLockWrite {
+	RWSpinLock &lock;
+
+public:
+	_ALWAYS_INLINE_ explicit RWSpinLockWrite(RWSpinLock &p_lock) :
+			lock(p_lock) {
+		lock.write_lock();
+	}
+	_ALWAYS_INLINE_ ~RWSpinLockWrite() {
+		lock.write_unlock();
 	}
 };
 
@@ -0,0 +1,252 @@
+/**************************************************************************/
+/*  spsc_queue.hpp                                                        */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_SPSC_QUEUE_HPP
+#define GODOT_SPSC_QUEUE_HPP
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/core/memory.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace godot {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+//
+// The capacity is rounded up to a power of 2. Each side keeps its index on its
+// own cache line, along with the last value it read from the other side, so
+// the two threads only share a cache line when the queue looks full or empty.
+template <typename T>
+class SPSCQueue {
+	T *buffer = nullptr;
+	uint32_t mask = 0;
+
+	// Padded by hand rather than with alignas(), which memnew doesn't honor.
+	uint8_t padding0[64];
+	std::atomic<uint32_t> tail{ 0 }; // Written by the producer.
+	uint32_t cached_head = 0;
+
+	uint8_t padding1[64];
+	std::atomic<uint32_t> head{ 0 }; // Written by the consumer.
+	uint32_t cached_tail = 0;
+	uint8_t padding2[64];
+
+public:
+	// Producer only. Returns false if the queue is full.
+	bool try_push(const T &p_value) {
+		const uint32_t pos = tail.load(std::memory_order_relaxed);
+		if (pos - cached_head > mask) {
+			cached_head = head.load(std::memory_order_acquire);
+			if (pos - cached_head > mask) {
+				return false;
+			}
+		}
+		memnew_placement(&buffer[pos & mask], T(p_value));
+		tail.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only. Returns false if the queue is empty.
+	bool try_pop(T &r_value) {
+		const uint32_t pos = head.load(std::memory_order_relaxed);
+		if (pos == cached_tail) {
+			cached_tail = tail.load(std::memory_order_acquire);
+			if (pos == cached_tail) {
+				return false;
+			}
+		}
+		T &slot = buffer[pos & mask];
+		r_value = std::move(slot);
+		slot.~T();
+		head.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Only exact when called from the producer or the consumer while the other side is idle.
+	_FORCE_INLINE_ uint32_t size() const {
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+	_FORCE_INLINE_ bool is_empty() const { return size() == 0; }
+	_FORCE_INLINE_ uint32_t get_capacity() const { return mask + 1; }
+
+	explicit SPSCQueue(uint32_t p_capacity = 1024) {
+		CRASH_COND_MSG(p_capacity > 0x80000000, "SPSCQueue capacity is too large.");
+		const uint32_t capacity = nearest_power_of_2_templated(MAX(p_capacity, 2u));
+		mask = capacity - 1;
+		buffer = (T *)memalloc(sizeof(T) * capacity);
+	}
+
+	SPSCQueue(const SPSCQueue &) = delete;
+	void operator=(const SPSCQueue &) = delete;
+
+	~SPSCQueue() {
+		if constexpr (!std::is_trivially_destructible_v<T>) {
+			const uint32_t end = tail.load(std::memory_order_acquire);
+			for (uint32_t pos = head.load(std::memory_order_relaxed); pos != end; pos++) {
+				buffer[pos & mask].~T();
+			}
+		}
+		memfree(buffer);
+	}
+};
+
+// Unbounded version of SPSCQueue: when the current block of the ring is full,
+// the producer links a new one, and the consumer frees blocks it has emptied.
+// The last freed block is kept aside for the producer to reuse, so a queue
+// oscillating around a block boundary doesn't allocate on each turn.
+template <typename T>
+class UnboundedSPSCQueue {
+	struct Block {
+		std::atomic<Block *> next{ nullptr };
+		T *buffer = nullptr;
+		uint32_t write_pos = 0; // Only used by the producer.
+		uint32_t read_pos = 0; // Only used by the consumer.
+		std::atomic<uint32_t> committed{ 0 }; // Elements the consumer may read.
+	};
+
+	uint32_t block_size = 0;
+
+	// Padded by hand rather than with alignas(), which memnew doesn't honor.
+	uint8_t padding0[64];
+	Block *tail_block = nullptr; // Owned by the producer.
+	std::atomic<uint32_t> pushed{ 0 };
+
+	uint8_t padding1[64];
+	Block *head_block = nullptr; // Owned by the consumer.
+	std::atomic<uint32_t> popped{ 0 };
+
+	uint8_t padding2[64];
+	std::atomic<Block *> spare_block{ nullptr };
+	uint8_t padding3[64];
+
+	Block *_alloc_block() {
+		Block *block = spare_block.exchange(nullptr, std::memory_order_acquire);
+		if (block) {
+			block->next.store(nullptr, std::memory_order_relaxed);
+			block->write_pos = 0;
+			block->read_pos = 0;
+			block->committed.store(0, std::memory_order_relaxed);
+			return block;
+		}
+		block = memnew(Block);
+		block->buffer = (T *)memalloc(sizeof(T) * block_size);
+		return block;
+	}
+
+	void _free_block(Block *p_block) {
+		memfree(p_block->buffer);
+		memdelete(p_block);
+	}
+
+public:
+	// Producer only, never fails.
+	void push(const T &p_value) {
+		Block *block = tail_block;
+		if (block->write_pos == block_size) {
+			Block *new_block = _alloc_block();
+			block->next.store(new_block, std::memory_order_release);
+			tail_block = new_block;
+			block = new_block;
+		}
+		memnew_placement(&block->buffer[block->write_pos], T(p_value));
+		block->write_pos++;
+		block->committed.store(block->write_pos, std::memory_order_release);
+		pushed.store(pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// Consumer only. Returns false if the queue is empty.
+	bool try_pop(T &r_value) {
+		Block *block = head_block;
+		if (block->read_pos == block_size) {
+			// Only move on once the producer has linked the next block.
+			Block *next = block->next.load(std::memory_order_acquire);
+			if (!next) {
+				return false;
+			}
+			head_block = next;
+			Block *old_spare = spare_block.exchange(block, std::memory_order_acq_rel);
+			if (old_spare) {
+				_free_block(old_spare);
+			}
+			block = next;
+		}
+		if (block->read_pos == block->committed.load(std::memory_order_acquire)) {
+			return false;
+		}
+		T &slot = block->buffer[block->read_pos];
+		r_value = std::move(slot);
+		slot.~T();
+		block->read_pos++;
+		popped.store(popped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Only exact when called from the producer or the consumer while the other side is idle.
+	_FORCE_INLINE_ uint32_t size() const {
+		return pushed.load(std::memory_order_acquire) - popped.load(std::memory_order_acquire);
+	}
+	_FORCE_INLINE_ bool is_empty() const { return size() == 0; }
+
+	explicit UnboundedSPSCQueue(uint32_t p_block_size = 1024) {
+		block_size = p_block_size < 2 ? 2 : p_block_size;
+		head_block = _alloc_block();
+		tail_block = head_block;
+	}
+
+	UnboundedSPSCQueue(const UnboundedSPSCQueue &) = delete;
+	void operator=(const UnboundedSPSCQueue &) = delete;
+
+	~UnboundedSPSCQueue() {
+		Block *block = head_block;
+		while (block) {
+			if constexpr (!std::is_trivially_destructible_v<T>) {
+				const uint32_t end = block->committed.load(std::memory_order_acquire);
+				for (uint32_t i = block->read_pos; i < end; i++) {
+					block->buffer[i].~T();
+				}
+			}
+			Block *next = block->next.load(std::memory_order_acquire);
+			_free_block(block);
+			block = next;
+		}
+		Block *spare = spare_block.load(std::memory_order_acquire);
+		if (spare) {
+			_free_block(spare);
+		}
+	}
+};
+
+} // namespace godot
+
+#endif // GODOT_SPSC_QUEUE_HPP
@@ -0,0 +1,358 @@
+/**************************************************************************/
+/*  task_graph.hpp                                                        */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_TASK_GRAPH_HPP
+#define GODOT_TASK_GRAPH_HPP
+
+#include <godot_cpp/classes/worker_thread_pool.hpp>
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/memory.hpp>
+#include <godot_cpp/templates/futex.hpp>
+#include <godot_cpp/templates/local_vector.hpp>
+#include <godot_cpp/variant/string.hpp>
+
+#include <atomic>
+#include <chrono>
+
+namespace godot {
+
+// Runs native tasks and group tasks on the WorkerThreadPool, each one starting
+// as soon as the nodes it depends on are done, e.g. animation -> physics prep ->
+// culling -> command building, without syncing with the main thread in between.
+//
+// The graph is built once and can be run again every frame: run() submits the
+// nodes without dependencies and returns, each finished node submits the nodes
+// it unblocks, and wait() blocks until the whole graph is done. Nodes hold plain
+// function pointers and userdata, like add_native_task(), so running doesn't
+// allocate besides what the WorkerThreadPool does.
+//
+// With set_record_timings(true), the start and end of each node are recorded
+// relative to run(), for use in a trace.
+class TaskGraph {
+public:
+	typedef uint32_t NodeID;
+	static constexpr NodeID INVALID_NODE = 0xFFFFFFFF;
+
+	struct NodeTiming {
+		uint64_t start_usec = 0;
+		uint64_t end_usec = 0;
+	};
+
+private:
+	struct Node {
+		TaskGraph *graph = nullptr;
+		void (*task_func)(void *) = nullptr;
+		void (*group_func)(void *, uint32_t) = nullptr;
+		void *userdata = nullptr;
+		int elements = 0;
+		int tasks = -1;
+		String description;
+
+		LocalVector<NodeID> successors;
+		uint32_t dependency_count = 0;
+
+		// Reset by run().
+		std::atomic<uint32_t> pending_dependencies{ 0 };
+		std::atomic<int> pending_elements{ 0 };
+		// The submitting thread storing the task ID, and the task finishing.
+		std::atomic<uint32_t> pending_releases{ 0 };
+		std::atomic<bool> started{ false };
+		WorkerThreadPool::TaskID task_id = WorkerThreadPool::INVALID_TASK_ID;
+
+		NodeTiming timing;
+	};
+
+	LocalVector<Node *> nodes;
+	LocalVector<NodeID> roots;
+	bool dirty = true;
+
+	bool high_priority = false;
+	bool record_timings = false;
+	std::chrono::steady_clock::time_point run_start;
+
+	std::atomic<uint32_t> remaining{ 0 }; // Nodes not fully done in the current run.
+	bool running = false;
+
+	_FORCE_INLINE_ uint64_t _get_time_usec() const {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - run_start).count();
+	}
+
+	static void _task_callback(void *p_node) {
+		Node *node = static_cast<Node *>(p_node);
+		TaskGraph *graph = node->graph;
+		if (graph->record_timings) {
+			node->timing.start_usec = graph->_get_time_usec();
+		}
+		node->task_func(node->userdata);
+		graph->_finish(node);
+	}
+
+	static void _group_callback(void *p_node, uint32_t p_index) {
+		Node *node = static_cast<Node *>(p_node);
+		TaskGraph *graph = node->graph;
+		if (graph->record_timings && !node->started.exchange(true, std::memory_order_relaxed)) {
+			node->timing.start_usec = graph->_get_time_usec();
+		}
+		node->group_func(node->userdata, p_index);
+		if (node->pending_elements.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			graph->_finish(node);
+		}
+	}
+
+	void _submit(Node *p_node) {
+		if (p_node->group_func && p_node->elements <= 0) {
+			// Nothing to run, but the successors still wait for it.
+			p_node->pending_releases.store(1, std::memory_order_relaxed);
+			if (record_timings) {
+				p_node->timing.start_usec = _get_time_usec();
+			}
+			_finish(p_node);
+			return;
+		}
+
+		WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+		if (p_node->group_func) {
+			p_node->task_id = pool->add_native_group_task(&TaskGraph::_group_callback, p_node, p_node->elements, p_node->tasks, high_priority, p_node->description);
+		} else {
+			p_node->task_id = pool->add_native_task(&TaskGraph::_task_callback, p_node, high_priority, p_node->description);
+		}
+		// The task may already be done, wait() needs the ID either way.
+		_release(p_node);
+	}
+
+	void _finish(Node *p_node) {
+		if (record_timings) {
+			p_node->timing.end_usec = _get_time_usec();
+		}
+		for (NodeID successor_id : p_node->successors) {
+			Node *successor = nodes[successor_id];
+			if (successor->pending_dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				_submit(successor);
+			}
+		}
+		_release(p_node);
+	}
+
+	void _release(Node *p_node) {
+		if (p_node->pending_releases.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				Futex::wake_all(remaining);
+			}
+		}
+	}
+
+	// Finds the nodes without dependencies and checks there's no cycle (Kahn's algorithm).
+	bool _update_roots() {
+		roots.clear();
+		LocalVector<uint32_t> in_degree;
+		in_degree.resize(nodes.size());
+		LocalVector<NodeID> queue;
+		for (NodeID i = 0; i < nodes.size(); i++) {
+			in_degree[i] = nodes[i]->dependency_count;
+			if (in_degree[i] == 0) {
+				roots.push_back(i);
+				queue.push_back(i);
+			}
+		}
+		for (uint32_t i = 0; i < queue.size(); i++) {
+			for (NodeID successor : nodes[queue[i]]->successors) {
+				if (--in_degree[successor] == 0) {
+					queue.push_back(successor);
+				}
+			}
+		}
+		ERR_FAIL_COND_V_MSG(queue.size() != nodes.size(), false, "TaskGraph has a dependency cycle.");
+		dirty = false;
+		return true;
+	}
+
+	NodeID _add_node(Node *p_node) {
+		p_node->graph = this;
+		nodes.push_back(p_node);
+		dirty = true;
+		return nodes.size() - 1;
+	}
+
+public:
+	// p_func(p_userdata) runs once per run().
+	NodeID add_task(void (*p_func)(void *), void *p_userdata, const String &p_description = String()) {
+		ERR_FAIL_COND_V(running, INVALID_NODE);
+		ERR_FAIL_NULL_V(p_func, INVALID_NODE);
+		Node *node = memnew(Node);
+		node->task_func = p_func;
+		node->userdata = p_userdata;
+		node->description = p_description;
+		return _add_node(node);
+	}
+
+	// p_func(p_userdata, index) runs for every index in [0, p_elements), on up to
+	// p_tasks threads, see WorkerThreadPool::add_native_group_task().
+	NodeID add_group_task(void (*p_func)(void *, uint32_t), void *p_userdata, int p_elements, int p_tasks = -1, const String &p_description = String()) {
+		ERR_FAIL_COND_V(running, INVALID_NODE);
+		ERR_FAIL_NULL_V(p_func, INVALID_NODE);
+		Node *node = memnew(Node);
+		node->group_func = p_func;
+		node->userdata = p_userdata;
+		node->elements = p_elements;
+		node->tasks = p_tasks;
+		node->description = p_description;
+		return _add_node(node);
+	}
+
+	// Changes the amount of elements of a group task for the next runs, e.g. the
+	// amount of visible objects this frame. With 0, the node is skipped.
+	void set_group_task_elements(NodeID p_node, int p_elements) {
+		ERR_FAIL_COND(running);
+		ERR_FAIL_UNSIGNED_INDEX(p_node, nodes.size());
+		ERR_FAIL_NULL_MSG(nodes[p_node]->group_func, "Not a group task.");
+		nodes[p_node]->elements = p_elements;
+	}
+
+	// p_node will only start once p_dependency is done.
+	void add_dependency(NodeID p_node, NodeID p_dependency) {
+		ERR_FAIL_COND(running);
+		ERR_FAIL_UNSIGNED_INDEX(p_node, nodes.size());
+		ERR_FAIL_UNSIGNED_INDEX(p_dependency, nodes.size());
+		ERR_FAIL_COND_MSG(p_node == p_dependency, "A node can't depend on itself.");
+		nodes[p_dependency]->successors.push_back(p_node);
+		nodes[p_node]->dependency_count++;
+		dirty = true;
+	}
+
+	// Submits the nodes without dependencies and returns right away.
+	void run() {
+		ERR_FAIL_COND_MSG(running, "TaskGraph is already running, call wait() first.");
+		if (nodes.is_empty()) {
+			return;
+		}
+		if (dirty && !_update_roots()) {
+			return;
+		}
+
+		for (Node *node : nodes) {
+			node->pending_dependencies.store(node->dependency_count, std::memory_order_relaxed);
+			node->pending_elements.store(node->elements, std::memory_order_relaxed);
+			node->pending_releases.store(2, std::memory_order_relaxed);
+			node->started.store(false, std::memory_order_relaxed);
+			node->task_id = WorkerThreadPool::INVALID_TASK_ID;
+			node->timing = NodeTiming();
+		}
+		remaining.store(nodes.size(), std::memory_order_relaxed);
+		running = true;
+		run_start = std::chrono::steady_clock::now();
+
+		for (NodeID root : roots) {
+			_submit(nodes[root]);
+		}
+	}
+
+	_FORCE_INLINE_ bool is_running() const { return running; }
+
+	// True once every node of the current run is done, wait() must still be called.
+	bool is_done() const {
+		return remaining.load(std::memory_order_acquire) == 0;
+	}
+
+	// Blocks until every node is done, then releases the tasks from the WorkerThreadPool.
+	void wait() {
+		if (!running) {
+			return;
+		}
+		uint32_t value = remaining.load(std::memory_order_acquire);
+		while (value != 0) {
+			Futex::wait(remaining, value);
+			value = remaining.load(std::memory_order_acquire);
+		}
+
+		WorkerThreadPool *pool = WorkerThreadPool::get_singleton();
+		for (Node *node : nodes) {
+			if (node->task_id == WorkerThreadPool::INVALID_TASK_ID) {
+				continue; // Skipped empty group.
+			}
+			if (node->group_func) {
+				pool->wait_for_group_task_completion(node->task_id);
+			} else {
+				pool->wait_for_task_completion(node->task_id);
+			}
+		}
+		running = false;
+	}
+
+	void run_and_wait() {
+		run();
+		wait();
+	}
+
+	void set_high_priority(bool p_enable) { high_priority = p_enable; }
+	bool is_high_priority() const { return high_priority; }
+
+	void set_record_timings(bool p_enable) {
+		ERR_FAIL_COND(running);
+		record_timings = p_enable;
+	}
+	bool is_recording_timings() const { return record_timings; }
+
+	// Start and end of the node in the last run, in microseconds since run() was called.
+	NodeTiming get_node_timing(NodeID p_node) const {
+		ERR_FAIL_COND_V(running, NodeTiming());
+		ERR_FAIL_UNSIGNED_INDEX_V(p_node, nodes.size(), NodeTiming());
+		return nodes[p_node]->timing;
+	}
+
+	String get_node_description(NodeID p_node) const {
+		ERR_FAIL_UNSIGNED_INDEX_V(p_node, nodes.size(), String());
+		return nodes[p_node]->description;
+	}
+
+	_FORCE_INLINE_ uint32_t get_node_count() const { return nodes.size(); }
+
+	void clear() {
+		ERR_FAIL_COND(running);
+		for (Node *node : nodes) {
+			memdelete(node);
+		}
+		nodes.clear();
+		roots.clear();
+		dirty = true;
+	}
+
+	TaskGraph() {}
+	TaskGraph(const TaskGraph &) = delete;
+	void operator=(const TaskGraph &) = delete;
+
+	~TaskGraph() {
+		wait();
+		clear();
+	}
+};
+
+} // namespace godot
+
+#endif // GODOT_TASK_GRAPH_HPP
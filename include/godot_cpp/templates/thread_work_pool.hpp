@@ -31,24 +31,89 @@
 #ifndef GODOT_THREAD_WORK_POOL_HPP
 #define GODOT_THREAD_WORK_POOL_HPP
 
-#include <godot_cpp/classes/os.hpp>
-#include <godot_cpp/classes/semaphore.hpp>
 #include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/math.hpp>
 #include <godot_cpp/core/memory.hpp>
+#include <godot_cpp/core/memory_pool.hpp>
+#include <godot_cpp/templates/futex.hpp>
+#include <godot_cpp/templates/small_vector.hpp>
+#include <godot_cpp/templates/spin_lock.hpp>
 
 #include <thread>
 
 #include <atomic>
+#include <cstddef>
+#include <type_traits>
 
 namespace godot {
 
+// Runs a method over a range of indices on a fixed set of threads.
+//
+// The range is split into one slice per worker. Each worker claims chunks of
+// `grain_size` indices from the front of its own slice, and once it's done,
+// steals chunks from the slices of the other workers, so uneven item costs
+// still keep every thread busy. Each slice has its own cache line, so cheap
+// items don't all hit a single shared counter.
+//
+// Threads are woken through Futex rather than engine semaphores, so the pool
+// makes no engine calls and can be used before the engine singletons exist.
+// Both the workers and the thread waiting in end_work() spin for a short,
+// adaptive amount of time before going to sleep, so dispatching many small
+// jobs in a row mostly avoids syscalls.
 class ThreadWorkPool {
-	std::atomic<uint32_t> index;
+	struct BaseWork;
+
+	// Bounds of the adaptive spin before sleeping, in _cpu_pause() rounds.
+	static constexpr uint32_t MIN_SPIN = 32;
+	static constexpr uint32_t MAX_SPIN = 2048;
+
+	struct ThreadData {
+		// Next index of this thread's slice. Stealing workers can push it past
+		// slice_end, so it's 64-bit to never wrap around.
+		alignas(64) std::atomic<uint64_t> next;
+		uint32_t slice_begin = 0;
+		uint32_t slice_end = 0;
+
+		// Incremented to start a job or to exit, the worker waits for it to change.
+		alignas(64) std::atomic<uint32_t> signal{ 0 };
+		std::atomic<uint32_t> sleeping{ 0 };
+		uint32_t spin_limit = MIN_SPIN;
+
+		uint32_t index = 0;
+		ThreadWorkPool *pool = nullptr;
+		std::thread thread;
+		std::atomic<bool> exit;
+		BaseWork *work;
+	};
 
 	struct BaseWork {
-		std::atomic<uint32_t> *index = nullptr;
+		ThreadData *threads = nullptr;
+		uint32_t threads_working = 0;
+		uint32_t grain_size = 1;
 		uint32_t max_elements = 0;
-		virtual void work() = 0;
+
+		// Claims the next chunk, from the slice of p_thread first, then from the others.
+		_FORCE_INLINE_ bool claim(uint32_t p_thread, uint32_t &r_from, uint32_t &r_to) {
+			for (uint32_t i = 0; i < threads_working; i++) {
+				uint32_t victim_index = p_thread + i;
+				if (victim_index >= threads_working) {
+					victim_index -= threads_working;
+				}
+				ThreadData &victim = threads[victim_index];
+				if (victim.next.load(std::memory_order_relaxed) >= victim.slice_end) {
+					continue; // Exhausted, don't push it further.
+				}
+				const uint64_t from = victim.next.fetch_add(grain_size, std::memory_order_relaxed);
+				if (from < victim.slice_end) {
+					r_from = uint32_t(from);
+					r_to = uint32_t(MIN(from + grain_size, uint64_t(victim.slice_end)));
+					return true;
+				}
+			}
+			return false;
+		}
+
+		virtual void work(uint32_t p_thread) = 0;
 		virtual ~BaseWork() = default;
 	};
 
@@ -57,65 +122,170 @@ class ThreadWorkPool {
 		C *instance;
 		M method;
 		U userdata;
-		virtual void work() {
-			while (true) {
-				uint32_t work_index = index->fetch_add(1, std::memory_order_relaxed);
-				if (work_index >= max_elements) {
-					break;
+		virtual void work(uint32_t p_thread) {
+			uint32_t from;
+			uint32_t to;
+			while (claim(p_thread, from, to)) {
+				for (uint32_t i = from; i < to; i++) {
+					(instance->*method)(i, userdata);
 				}
-				(instance->*method)(work_index, userdata);
 			}
 		}
 	};
 
-	struct ThreadData {
-		std::thread thread;
-		Semaphore start;
-		Semaphore completed;
-		std::atomic<bool> exit;
-		BaseWork *work;
+	// Used by parallel_for(), the function gets whole chunks and can be inlined in the loop.
+	template <typename F>
+	struct RangeWork : public BaseWork {
+		F *function;
+		uint32_t begin;
+		virtual void work(uint32_t p_thread) {
+			uint32_t from;
+			uint32_t to;
+			while (claim(p_thread, from, to)) {
+				(*function)(begin + from, begin + to);
+			}
+		}
 	};
 
+	// Work objects fitting here are built in place, so dispatching doesn't allocate.
+	static constexpr size_t WORK_STORAGE_SIZE = 128;
+
 	ThreadData *threads = nullptr;
 	uint32_t thread_count = 0;
 	uint32_t threads_working = 0;
 	BaseWork *current_work = nullptr;
+	alignas(std::max_align_t) uint8_t work_storage[WORK_STORAGE_SIZE];
+
+	// Spinning only delays the thread we wait for when there's a single core.
+	uint32_t max_spin = 0;
+
+	// Workers still running the current job, the last one wakes end_work().
+	// Padded by hand rather than with alignas(), which memnew doesn't honor.
+	uint8_t padding0[64];
+	std::atomic<uint32_t> pending{ 0 };
+	std::atomic<uint32_t> waiter_sleeping{ 0 };
+	uint32_t waiter_spin_limit = MIN_SPIN;
+	uint8_t padding1[64];
+
+	// Waits until p_word isn't p_old anymore, and returns its new value.
+	// The spin limit doubles when the wait ends while spinning and halves when it
+	// had to sleep. p_sleeping tells the other side a wake up call is needed.
+	static uint32_t _wait_for_change(std::atomic<uint32_t> &p_word, uint32_t p_old, std::atomic<uint32_t> &p_sleeping, uint32_t &r_spin_limit, uint32_t p_max_spin) {
+		const uint32_t spin_limit = MIN(r_spin_limit, p_max_spin);
+		for (uint32_t i = 0; i < spin_limit; i++) {
+			const uint32_t value = p_word.load(std::memory_order_acquire);
+			if (value != p_old) {
+				r_spin_limit = MIN(r_spin_limit * 2, MAX_SPIN);
+				return value;
+			}
+			_cpu_pause();
+		}
+		r_spin_limit = MAX(r_spin_limit / 2, MIN_SPIN);
+
+		while (true) {
+			// Sequentially consistent, pairs with _wake(), so either this thread sees
+			// the new value, or the other side sees it's sleeping.
+			p_sleeping.store(1);
+			const uint32_t value = p_word.load();
+			if (value != p_old) {
+				p_sleeping.store(0, std::memory_order_relaxed);
+				return value;
+			}
+			Futex::wait(p_word, p_old);
+		}
+	}
+
+	// Call after changing p_word with a sequentially consistent operation.
+	_FORCE_INLINE_ static void _wake(std::atomic<uint32_t> &p_word, std::atomic<uint32_t> &p_sleeping) {
+		if (p_sleeping.load()) {
+			Futex::wake_one(p_word);
+		}
+	}
 
 	static void _thread_function(void *p_user) {
 		ThreadData *thread = static_cast<ThreadData *>(p_user);
+		ThreadWorkPool *pool = thread->pool;
+		uint32_t signal = 0;
 		while (true) {
-			thread->start.wait();
+			signal = _wait_for_change(thread->signal, signal, thread->sleeping, thread->spin_limit, pool->max_spin);
 			if (thread->exit.load()) {
 				break;
 			}
-			thread->work->work();
-			thread->completed.post();
+			thread->work->work(thread->index);
+			if (pool->pending.fetch_sub(1) == 1) {
+				_wake(pool->pending, pool->waiter_sleeping);
+			}
+		}
+#ifdef MEMORY_POOL_ENABLED
+		MemoryPool::flush_thread_cache();
+#endif
+	}
+
+	template <typename W>
+	W *_create_work() {
+		if constexpr (sizeof(W) <= WORK_STORAGE_SIZE && alignof(W) <= alignof(std::max_align_t)) {
+			return memnew_placement(work_storage, W);
+		} else {
+			return memnew(W);
+		}
+	}
+
+	_FORCE_INLINE_ uint32_t _get_grain_size(uint32_t p_elements, uint32_t p_grain_size) const {
+		if (p_grain_size > 0) {
+			return p_grain_size;
+		}
+		return MAX(1u, p_elements / (MAX(thread_count, 1u) * AUTO_CHUNKS_PER_THREAD));
+	}
+
+	void _dispatch(BaseWork *p_work, uint32_t p_elements, uint32_t p_grain_size) {
+		const uint32_t grain_size = _get_grain_size(p_elements, p_grain_size);
+		const uint32_t chunk_count = p_elements / grain_size + (p_elements % grain_size ? 1 : 0);
+		threads_working = MIN(chunk_count, thread_count);
+
+		p_work->threads = threads;
+		p_work->threads_working = threads_working;
+		p_work->grain_size = grain_size;
+		p_work->max_elements = p_elements;
+
+		// Slices are made of whole chunks, so only the last one can end with a partial chunk.
+		for (uint32_t i = 0; i < threads_working; i++) {
+			const uint64_t slice_begin = uint64_t(chunk_count) * i / threads_working * grain_size;
+			const uint64_t slice_end = uint64_t(chunk_count) * (i + 1) / threads_working * grain_size;
+			threads[i].slice_begin = uint32_t(slice_begin);
+			threads[i].slice_end = uint32_t(MIN(slice_end, uint64_t(p_elements)));
+			threads[i].next.store(slice_begin, std::memory_order_relaxed);
+		}
+
+		current_work = p_work;
+		pending.store(threads_working, std::memory_order_relaxed);
+
+		for (uint32_t i = 0; i < threads_working; i++) {
+			threads[i].work = p_work;
+			threads[i].signal.fetch_add(1);
+			_wake(threads[i].signal, threads[i].sleeping);
 		}
 	}
 
 public:
+	// About this many chunks per thread when no grain size is given, enough to
+	// balance uneven items without making the claims themselves noticeable.
+	static constexpr uint32_t AUTO_CHUNKS_PER_THREAD = 32;
+
+	// parallel_reduce() uses this many chunks when no grain size is given,
+	// regardless of the amount of threads, so the result is the same everywhere.
+	static constexpr uint32_t REDUCE_CHUNK_COUNT = 64;
+
+	// A p_grain_size of 0 picks one from the amount of elements and threads.
 	template <typename C, typename M, typename U>
-	void begin_work(uint32_t p_elements, C *p_instance, M p_method, U p_userdata) {
+	void begin_work(uint32_t p_elements, C *p_instance, M p_method, U p_userdata, uint32_t p_grain_size = 0) {
 		ERR_FAIL_NULL(threads); // Never initialized.
 		ERR_FAIL_COND(current_work != nullptr);
 
-		index.store(0, std::memory_order_release);
-
-		Work<C, M, U> *w = new (Work<C, M, U>);
+		Work<C, M, U> *w = _create_work<Work<C, M, U>>();
 		w->instance = p_instance;
 		w->userdata = p_userdata;
 		w->method = p_method;
-		w->index = &index;
-		w->max_elements = p_elements;
-
-		current_work = w;
-
-		threads_working = Math::min(p_elements, thread_count);
-
-		for (uint32_t i = 0; i < threads_working; i++) {
-			threads[i].work = w;
-			threads[i].start.post();
-		}
+		_dispatch(w, p_elements, p_grain_size);
 	}
 
 	bool is_working() const {
@@ -124,29 +294,46 @@ public:
 
 	bool is_done_dispatching() const {
 		ERR_FAIL_NULL_V(current_work, true);
-		return index.load(std::memory_order_acquire) >= current_work->max_elements;
+		for (uint32_t i = 0; i < threads_working; i++) {
+			if (threads[i].next.load(std::memory_order_acquire) < threads[i].slice_end) {
+				return false;
+			}
+		}
+		return true;
 	}
 
+	// Amount of elements handed to the workers so far.
 	uint32_t get_work_index() const {
 		ERR_FAIL_NULL_V(current_work, 0);
-		uint32_t idx = index.load(std::memory_order_acquire);
-		return Math::min(idx, current_work->max_elements);
+		uint32_t idx = 0;
+		for (uint32_t i = 0; i < threads_working; i++) {
+			const uint64_t next = threads[i].next.load(std::memory_order_acquire);
+			idx += uint32_t(MIN(next, uint64_t(threads[i].slice_end)) - threads[i].slice_begin);
+		}
+		return idx;
 	}
 
 	void end_work() {
 		ERR_FAIL_NULL(current_work);
+		uint32_t remaining = pending.load(std::memory_order_acquire);
+		while (remaining != 0) {
+			remaining = _wait_for_change(pending, remaining, waiter_sleeping, waiter_spin_limit, max_spin);
+		}
 		for (uint32_t i = 0; i < threads_working; i++) {
-			threads[i].completed.wait();
 			threads[i].work = nullptr;
 		}
 
 		threads_working = 0;
-		delete current_work;
+		if ((void *)current_work == (void *)work_storage) {
+			current_work->~BaseWork();
+		} else {
+			memdelete(current_work);
+		}
 		current_work = nullptr;
 	}
 
 	template <typename C, typename M, typename U>
-	void do_work(uint32_t p_elements, C *p_instance, M p_method, U p_userdata) {
+	void do_work(uint32_t p_elements, C *p_instance, M p_method, U p_userdata, uint32_t p_grain_size = 0) {
 		switch (p_elements) {
 			case 0:
 				// Nothing to do, so do nothing.
@@ -158,22 +345,100 @@ public:
 				break;
 			default:
 				// Multiple jobs to do; commence threaded business.
-				begin_work(p_elements, p_instance, p_method, p_userdata);
+				begin_work(p_elements, p_instance, p_method, p_userdata, p_grain_size);
 				end_work();
 		}
 	}
 
+	// Calls p_function(from, to) on chunks of [p_begin, p_end) of p_grain_size
+	// indices, and waits until every chunk is done. A p_grain_size of 0 picks one.
+	// If the pool is busy, e.g. when called from one of its own jobs, or wasn't
+	// initialized, the whole range runs on the calling thread instead.
+	//
+	//   pool.parallel_for(0, count, 256, [&](uint32_t p_from, uint32_t p_to) {
+	//       for (uint32_t i = p_from; i < p_to; i++) {
+	//           positions[i] += velocities[i] * delta;
+	//       }
+	//   });
+	template <typename F>
+	void parallel_for(uint32_t p_begin, uint32_t p_end, uint32_t p_grain_size, F &&p_function) {
+		if (p_end <= p_begin) {
+			return;
+		}
+		const uint32_t elements = p_end - p_begin;
+		if (thread_count == 0 || threads == nullptr || current_work != nullptr || elements <= _get_grain_size(elements, p_grain_size)) {
+			// A single chunk is not worth waking a thread.
+			p_function(p_begin, p_end);
+			return;
+		}
+
+		typedef std::remove_reference_t<F> FunctionType;
+		RangeWork<FunctionType> *w = _create_work<RangeWork<FunctionType>>();
+		w->function = &p_function;
+		w->begin = p_begin;
+		_dispatch(w, elements, p_grain_size);
+		end_work();
+	}
+
+	// Returns combine(...combine(combine(identity, map(p_begin)), map(p_begin + 1))..., map(p_end - 1))
+	// for an associative p_combine, computed in parallel.
+	//
+	// The range is cut in chunks of p_grain_size indices (REDUCE_CHUNK_COUNT chunks
+	// if 0), each reduced from p_identity, then the results of the chunks are combined
+	// in order on the calling thread. The chunks only depend on the range and grain
+	// size, so the result is the same on every run and machine, even for floating
+	// point sums.
+	template <typename T, typename MapF, typename CombineF>
+	T parallel_reduce(uint32_t p_begin, uint32_t p_end, uint32_t p_grain_size, const T &p_identity, MapF &&p_map, CombineF &&p_combine) {
+		if (p_end <= p_begin) {
+			return p_identity;
+		}
+		const uint32_t elements = p_end - p_begin;
+		const uint32_t grain_size = p_grain_size > 0 ? p_grain_size : MAX(1u, elements / REDUCE_CHUNK_COUNT + (elements % REDUCE_CHUNK_COUNT ? 1 : 0));
+		const uint32_t chunk_count = elements / grain_size + (elements % grain_size ? 1 : 0);
+
+		SmallVector<T, REDUCE_CHUNK_COUNT> partials;
+		partials.reserve(chunk_count);
+		for (uint32_t i = 0; i < chunk_count; i++) {
+			partials.push_back(p_identity);
+		}
+
+		parallel_for(p_begin, p_end, grain_size, [&](uint32_t p_from, uint32_t p_to) {
+			// Ranges hold several chunks when parallel_for() runs them on the calling thread.
+			uint32_t chunk_from = p_from;
+			while (chunk_from < p_to) {
+				const uint32_t chunk_to = chunk_from + MIN(grain_size, p_to - chunk_from);
+				T value = p_identity;
+				for (uint32_t i = chunk_from; i < chunk_to; i++) {
+					value = p_combine(value, p_map(i));
+				}
+				partials[(chunk_from - p_begin) / grain_size] = value;
+				chunk_from = chunk_to;
+			}
+		});
+
+		T result = p_identity;
+		for (uint32_t i = 0; i < chunk_count; i++) {
+			result = p_combine(result, partials[i]);
+		}
+		return result;
+	}
+
 	_FORCE_INLINE_ int get_thread_count() const { return thread_count; }
 	void init(int p_thread_count = -1) {
 		ERR_FAIL_COND(threads != nullptr);
+		const uint32_t processor_count = MAX(std::thread::hardware_concurrency(), 1u);
 		if (p_thread_count < 0) {
-			p_thread_count = OS::get_singleton()->get_processor_count();
+			p_thread_count = processor_count;
 		}
 
 		thread_count = p_thread_count;
 		threads = new ThreadData[thread_count];
+		max_spin = processor_count > 1 ? MAX_SPIN : 0;
 
 		for (uint32_t i = 0; i < thread_count; i++) {
+			threads[i].index = i;
+			threads[i].pool = this;
 			threads[i].exit.store(false);
 			threads[i].thread = std::thread(&ThreadWorkPool::_thread_function, &threads[i]);
 		}
@@ -186,7 +451,8 @@ public:
 
 		for (uint32_t i = 0; i < thread_count; i++) {
 			threads[i].exit.store(true);
-			threads[i].start.post();
+			threads[i].signal.fetch_add(1);
+			_wake(threads[i].signal, threads[i].sleeping);
 		}
 		for (uint32_t i = 0; i < thread_count; i++) {
 			threads[i].thread.join();
@@ -0,0 +1,307 @@
+/**************************************************************************/
+/*  unique_vector.hpp                                                     */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef GODOT_UNIQUE_VECTOR_HPP
+#define GODOT_UNIQUE_VECTOR_HPP
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/memory.hpp>
+#include <godot_cpp/templates/cowdata.hpp>
+#include <godot_cpp/templates/radix_sort.hpp>
+#include <godot_cpp/templates/search_array.hpp>
+#include <godot_cpp/templates/sort_array.hpp>
+#include <godot_cpp/templates/vector.hpp>
+
+#include <initializer_list>
+
+namespace godot {
+
+/**
+ * Vector with a single owner: copies are deep and there is no copy-on-write,
+ * so it never touches the atomic reference count of its buffer. Use it for
+ * vectors that stay in one thread or are handed over by moving them.
+ *
+ * It uses the same buffer layout as Vector, so converting between the two
+ * doesn't copy the elements: share() moves the data into a Vector, and
+ * constructing from a Vector rvalue takes the buffer over if it isn't shared.
+ *
+ * Unlike Vector, elements are written directly through operator[] (there is no `write`).
+ */
+template <typename T, size_t alignment = alignof(max_align_t)>
+class UniqueVector {
+public:
+	typedef typename CowData<T, alignment>::Size Size;
+
+private:
+	CowData<T, alignment> _cowdata; // The reference count is always 1.
+
+	_FORCE_INLINE_ void _reset() {
+		if (_cowdata._ptr) {
+			_cowdata._free_data(_cowdata._ptr);
+			_cowdata._ptr = nullptr;
+		}
+	}
+
+	void _take(Vector<T, alignment> &p_from) {
+		_reset();
+		SWAP(_cowdata._ptr, p_from._cowdata._ptr);
+		_cowdata._copy_on_write(); // Copies the data if other Vectors still reference it.
+	}
+
+	void _copy(const T *p_data, Size p_size) {
+		_reset();
+		_cowdata.insert_range(0, p_data, p_size);
+	}
+
+public:
+	bool push_back(T p_elem);
+	_FORCE_INLINE_ bool append(const T &p_elem) { return push_back(p_elem); } //alias
+	void fill(T p_elem);
+
+	void remove_at(Size p_index) { _cowdata.remove_at(p_index); }
+	_FORCE_INLINE_ bool erase(const T &p_val) {
+		Size idx = find(p_val);
+		if (idx >= 0) {
+			remove_at(idx);
+			return true;
+		}
+		return false;
+	}
+
+	void reverse();
+
+	_FORCE_INLINE_ T *ptrw() { return _cowdata._ptr; }
+	_FORCE_INLINE_ const T *ptr() const { return _cowdata._ptr; }
+	_FORCE_INLINE_ void clear() { _reset(); }
+	_FORCE_INLINE_ bool is_empty() const { return _cowdata.is_empty(); }
+
+	_FORCE_INLINE_ const T &get(Size p_index) const { return _cowdata.get(p_index); }
+	_FORCE_INLINE_ void set(Size p_index, const T &p_elem) {
+		ERR_FAIL_INDEX(p_index, size());
+		_cowdata._ptr[p_index] = p_elem;
+	}
+	_FORCE_INLINE_ Size size() const { return _cowdata.size(); }
+	Error resize(Size p_size) {
+		if (p_size == 0) {
+			_reset();
+			return OK;
+		}
+		return _cowdata.resize(p_size);
+	}
+	Error resize_zeroed(Size p_size) {
+		if (p_size == 0) {
+			_reset();
+			return OK;
+		}
+		return _cowdata.template resize<true>(p_size);
+	}
+	Error reserve(Size p_capacity) { return _cowdata.reserve(p_capacity); }
+	Error shrink_to_fit() { return _cowdata.shrink_to_fit(); }
+	_FORCE_INLINE_ Size get_capacity() const { return _cowdata.get_capacity(); }
+	_FORCE_INLINE_ const T &operator[](Size p_index) const { return _cowdata.get(p_index); }
+	_FORCE_INLINE_ T &operator[](Size p_index) {
+		CRASH_BAD_INDEX(p_index, size());
+		return _cowdata._ptr[p_index];
+	}
+	Error insert(Size p_pos, T p_val) { return _cowdata.insert(p_pos, p_val); }
+	Error insert_range(Size p_pos, const T *p_values, Size p_count) { return _cowdata.insert_range(p_pos, p_values, p_count); }
+	Error remove_range(Size p_index, Size p_count) { return _cowdata.remove_range(p_index, p_count); }
+	Size find(const T &p_val, Size p_from = 0) const { return _cowdata.find(p_val, p_from); }
+	Size rfind(const T &p_val, Size p_from = -1) const { return _cowdata.rfind(p_val, p_from); }
+	Size count(const T &p_val) const { return _cowdata.count(p_val); }
+
+	void append_array(const UniqueVector &p_other) { _cowdata.insert_range(size(), p_other.ptr(), p_other.size()); }
+	void append_array(const Vector<T, alignment> &p_other) { _cowdata.insert_range(size(), p_other.ptr(), p_other.size()); }
+	void append_array(const T *p_values, Size p_count) { _cowdata.insert_range(size(), p_values, p_count); }
+
+	_FORCE_INLINE_ bool has(const T &p_val) const { return find(p_val) != -1; }
+
+	void sort() {
+		sort_custom<_DefaultComparator<T>>();
+	}
+
+	template <typename Comparator, bool Validate = SORT_ARRAY_VALIDATE_ENABLED, typename... Args>
+	void sort_custom(Args &&...args) {
+		Size len = _cowdata.size();
+		if (len == 0) {
+			return;
+		}
+
+		SortArray<T, Comparator, Validate> sorter{ args... };
+		sorter.sort(ptrw(), len);
+	}
+
+	// Stable sort by an integer or floating point key, see RadixSort.
+	template <typename KeyGetter = _DefaultRadixKey<T>, typename... Args>
+	void radix_sort(Args &&...args) {
+		Size len = _cowdata.size();
+		if (len == 0) {
+			return;
+		}
+
+		RadixSort<T, KeyGetter> sorter{ args... };
+		sorter.sort(ptrw(), len);
+	}
+
+	Size bsearch(const T &p_value, bool p_before) const {
+		return bsearch_custom<_DefaultComparator<T>>(p_value, p_before);
+	}
+
+	template <typename Comparator, typename Value, typename... Args>
+	Size bsearch_custom(const Value &p_value, bool p_before, Args &&...args) const {
+		SearchArray<T, Comparator> search{ args... };
+		return search.bisect(ptr(), size(), p_value, p_before);
+	}
+
+	void ordered_insert(const T &p_val) {
+		Size i;
+		for (i = 0; i < _cowdata.size(); i++) {
+			if (p_val < operator[](i)) {
+				break;
+			}
+		}
+		insert(i, p_val);
+	}
+
+	// Moves the data into a Vector, which can then be copied and shared between threads.
+	// This UniqueVector is left empty.
+	Vector<T, alignment> share() {
+		Vector<T, alignment> ret;
+		SWAP(ret._cowdata._ptr, _cowdata._ptr);
+		return ret;
+	}
+
+	// Copies the data into a new Vector.
+	Vector<T, alignment> to_vector() const {
+		Vector<T, alignment> ret;
+		ret.append_array(ptr(), size());
+		return ret;
+	}
+
+	Vector<uint8_t> to_byte_array() const {
+		Vector<uint8_t> ret;
+		if (is_empty()) {
+			return ret;
+		}
+		ret.resize(size() * sizeof(T));
+		memcpy(ret.ptrw(), ptr(), sizeof(T) * size());
+		return ret;
+	}
+
+	bool operator==(const UniqueVector &p_arr) const {
+		Size s = size();
+		if (s != p_arr.size()) {
+			return false;
+		}
+		for (Size i = 0; i < s; i++) {
+			if (operator[](i) != p_arr[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool operator!=(const UniqueVector &p_arr) const {
+		return !operator==(p_arr);
+	}
+
+	typedef typename Vector<T, alignment>::Iterator Iterator;
+	typedef typename Vector<T, alignment>::ConstIterator ConstIterator;
+
+	_FORCE_INLINE_ Iterator begin() {
+		return Iterator(ptrw());
+	}
+	_FORCE_INLINE_ Iterator end() {
+		return Iterator(ptrw() + size());
+	}
+
+	_FORCE_INLINE_ ConstIterator begin() const {
+		return ConstIterator(ptr());
+	}
+	_FORCE_INLINE_ ConstIterator end() const {
+		return ConstIterator(ptr() + size());
+	}
+
+	inline void operator=(const UniqueVector &p_from) {
+		if (this != &p_from) {
+			_copy(p_from.ptr(), p_from.size());
+		}
+	}
+	inline void operator=(UniqueVector &&p_from) {
+		SWAP(_cowdata._ptr, p_from._cowdata._ptr);
+	}
+	inline void operator=(const Vector<T, alignment> &p_from) {
+		_copy(p_from.ptr(), p_from.size());
+	}
+	inline void operator=(Vector<T, alignment> &&p_from) {
+		_take(p_from);
+	}
+
+	_FORCE_INLINE_ UniqueVector() {}
+	_FORCE_INLINE_ UniqueVector(std::initializer_list<T> p_init) {
+		_cowdata.insert_range(0, p_init.begin(), p_init.size());
+	}
+	_FORCE_INLINE_ UniqueVector(const UniqueVector &p_from) { _copy(p_from.ptr(), p_from.size()); }
+	_FORCE_INLINE_ UniqueVector(UniqueVector &&p_from) { SWAP(_cowdata._ptr, p_from._cowdata._ptr); }
+	_FORCE_INLINE_ explicit UniqueVector(const Vector<T, alignment> &p_from) { _copy(p_from.ptr(), p_from.size()); }
+	_FORCE_INLINE_ explicit UniqueVector(Vector<T, alignment> &&p_from) { _take(p_from); }
+
+	_FORCE_INLINE_ ~UniqueVector() { _reset(); }
+};
+
+template <typename T, size_t alignment>
+void UniqueVector<T, alignment>::reverse() {
+	T *p = ptrw();
+	for (Size i = 0; i < size() / 2; i++) {
+		SWAP(p[i], p[size() - i - 1]);
+	}
+}
+
+template <typename T, size_t alignment>
+bool UniqueVector<T, alignment>::push_back(T p_elem) {
+	const Size s = size();
+	Error err = resize(s + 1);
+	ERR_FAIL_COND_V(err, true);
+	_cowdata._ptr[s] = p_elem;
+
+	return false;
+}
+
+template <typename T, size_t alignment>
+void UniqueVector<T, alignment>::fill(T p_elem) {
+	T *p = ptrw();
+	for (Size i = 0; i < size(); i++) {
+		p[i] = p_elem;
+	}
+}
+
+} // namespace godot
+
+#endif // GODOT_UNIQUE_VECTOR_HPP
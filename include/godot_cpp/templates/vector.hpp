@@ -39,34 +39,39 @@
 #include <godot_cpp/core/error_macros.hpp>
 #include <godot_cpp/core/memory.hpp>
 #include <godot_cpp/templates/cowdata.hpp>
+#include <godot_cpp/templates/radix_sort.hpp>
 #include <godot_cpp/templates/search_array.hpp>
 #include <godot_cpp/templates/sort_array.hpp>
 
 #include <climits>
 #include <initializer_list>
+#include <type_traits>
+#include <utility>
 
 namespace godot {
 
-template <typename T>
+template <typename T, size_t alignment = alignof(max_align_t)>
 class VectorWriteProxy {
 public:
-	_FORCE_INLINE_ T &operator[](typename CowData<T>::Size p_index) {
-		CRASH_BAD_INDEX(p_index, ((Vector<T> *)(this))->_cowdata.size());
+	_FORCE_INLINE_ T &operator[](typename CowData<T, alignment>::Size p_index) {
+		CRASH_BAD_INDEX(p_index, ((Vector<T, alignment> *)(this))->_cowdata.size());
 
-		return ((Vector<T> *)(this))->_cowdata.ptrw()[p_index];
+		return ((Vector<T, alignment> *)(this))->_cowdata.ptrw()[p_index];
 	}
 };
 
-template <typename T>
+// The data is aligned to `alignment` bytes, e.g. 32 or 64 for SIMD loads.
+template <typename T, size_t alignment = alignof(max_align_t)>
 class Vector {
-	friend class VectorWriteProxy<T>;
+	friend class VectorWriteProxy<T, alignment>;
+	friend class UniqueVector<T, alignment>;
 
 public:
-	VectorWriteProxy<T> write;
-	typedef typename CowData<T>::Size Size;
+	VectorWriteProxy<T, alignment> write;
+	typedef typename CowData<T, alignment>::Size Size;
 
 private:
-	CowData<T> _cowdata;
+	CowData<T, alignment> _cowdata;
 
 public:
 	bool push_back(T p_elem);
@@ -96,13 +101,21 @@ public:
 	_FORCE_INLINE_ Size size() const { return _cowdata.size(); }
 	Error resize(Size p_size) { return _cowdata.resize(p_size); }
 	Error resize_zeroed(Size p_size) { return _cowdata.template resize<true>(p_size); }
+	Error reserve(Size p_capacity) { return _cowdata.reserve(p_capacity); }
+	Error shrink_to_fit() { return _cowdata.shrink_to_fit(); }
+	_FORCE_INLINE_ Size get_capacity() const { return _cowdata.get_capacity(); }
 	_FORCE_INLINE_ const T &operator[](Size p_index) const { return _cowdata.get(p_index); }
 	Error insert(Size p_pos, T p_val) { return _cowdata.insert(p_pos, p_val); }
+	Error insert_range(Size p_pos, const T *p_values, Size p_count) { return _cowdata.insert_range(p_pos, p_values, p_count); }
+	Error insert_range(Size p_pos, const Vector &p_values) { return _cowdata.insert_range(p_pos, p_values.ptr(), p_values.size()); }
+	Error remove_range(Size p_index, Size p_count) { return _cowdata.remove_range(p_index, p_count); }
 	Size find(const T &p_val, Size p_from = 0) const { return _cowdata.find(p_val, p_from); }
 	Size rfind(const T &p_val, Size p_from = -1) const { return _cowdata.rfind(p_val, p_from); }
 	Size count(const T &p_val) const { return _cowdata.count(p_val); }
 
-	void append_array(Vector<T> p_other);
+	void append_array(const Vector &p_other) { _cowdata.insert_range(size(), p_other.ptr(), p_other.size()); }
+	void append_array(const T *p_values, Size p_count) { _cowdata.insert_range(size(), p_values, p_count); }
+	void append_array(Vector &&p_other);
 
 	_FORCE_INLINE_ bool has(const T &p_val) const { return find(p_val) != -1; }
 
@@ -122,6 +135,18 @@ public:
 		sorter.sort(data, len);
 	}
 
+	// Stable sort by an integer or floating point key, see RadixSort.
+	template <typename KeyGetter = _DefaultRadixKey<T>, typename... Args>
+	void radix_sort(Args &&...args) {
+		Size len = _cowdata.size();
+		if (len == 0) {
+			return;
+		}
+
+		RadixSort<T, KeyGetter> sorter{ args... };
+		sorter.sort(ptrw(), len);
+	}
+
 	Size bsearch(const T &p_value, bool p_before) {
 		return bsearch_custom<_DefaultComparator<T>>(p_value, p_before);
 	}
@@ -132,7 +157,7 @@ public:
 		return search.bisect(ptrw(), size(), p_value, p_before);
 	}
 
-	Vector<T> duplicate() {
+	Vector duplicate() {
 		return *this;
 	}
 
@@ -160,8 +185,8 @@ public:
 		return ret;
 	}
 
-	Vector<T> slice(Size p_begin, Size p_end = CowData<T>::MAX_INT) const {
-		Vector<T> result;
+	Vector slice(Size p_begin, Size p_end = CowData<T, alignment>::MAX_INT) const {
+		Vector result;
 
 		const Size s = size();
 
@@ -188,7 +213,7 @@ public:
 		return result;
 	}
 
-	bool operator==(const Vector<T> &p_arr) const {
+	bool operator==(const Vector &p_arr) const {
 		Size s = size();
 		if (s != p_arr.size()) {
 			return false;
@@ -201,7 +226,7 @@ public:
 		return true;
 	}
 
-	bool operator!=(const Vector<T> &p_arr) const {
+	bool operator!=(const Vector &p_arr) const {
 		Size s = size();
 		if (s != p_arr.size()) {
 			return true;
@@ -293,38 +318,60 @@ public:
 	_FORCE_INLINE_ ~Vector() {}
 };
 
-template <typename T>
-void Vector<T>::reverse() {
+template <typename T, size_t alignment>
+void Vector<T, alignment>::reverse() {
 	for (Size i = 0; i < size() / 2; i++) {
 		T *p = ptrw();
 		SWAP(p[i], p[size() - i - 1]);
 	}
 }
 
-template <typename T>
-void Vector<T>::append_array(Vector<T> p_other) {
+// Moves the elements when p_other is their only owner, otherwise copies them.
+template <typename T, size_t alignment>
+void Vector<T, alignment>::append_array(Vector<T, alignment> &&p_other) {
 	const Size ds = p_other.size();
 	if (ds == 0) {
 		return;
 	}
-	const Size bs = size();
-	resize(bs + ds);
-	for (Size i = 0; i < ds; ++i) {
-		ptrw()[bs + i] = p_other[i];
+	if (unlikely(&p_other == this)) {
+		append_array(ptr(), ds);
+		return;
+	}
+	if (is_empty()) {
+		SWAP(_cowdata._ptr, p_other._cowdata._ptr);
+		return;
+	}
+	if constexpr (std::is_trivially_copyable_v<T>) {
+		append_array(p_other.ptr(), ds);
+	} else {
+		if (p_other._cowdata._get_refcount()->get() > 1) {
+			append_array(p_other.ptr(), ds);
+			return;
+		}
+		const Size bs = size();
+		Error err = resize(bs + ds);
+		ERR_FAIL_COND(err);
+		T *w = _cowdata._ptr;
+		T *r = p_other._cowdata._ptr;
+		for (Size i = 0; i < ds; ++i) {
+			w[bs + i] = std::move(r[i]);
+		}
 	}
+	p_other.clear();
 }
 
-template <typename T>
-bool Vector<T>::push_back(T p_elem) {
-	Error err = resize(size() + 1);
+template <typename T, size_t alignment>
+bool Vector<T, alignment>::push_back(T p_elem) {
+	const Size s = size();
+	Error err = resize(s + 1);
 	ERR_FAIL_COND_V(err, true);
-	set(size() - 1, p_elem);
+	_cowdata._ptr[s] = p_elem;
 
 	return false;
 }
 
-template <typename T>
-void Vector<T>::fill(T p_elem) {
+template <typename T, size_t alignment>
+void Vector<T, alignment>::fill(T p_elem) {
 	T *p = ptrw();
 	for (Size i = 0; i < size(); i++) {
 		p[i] = p_elem;
@@ -32,6 +32,7 @@
 #define GODOT_VMAP_HPP
 
 #include <godot_cpp/templates/cowdata.hpp>
+#include <godot_cpp/templates/search_array.hpp>
 
 namespace godot {
 
@@ -53,65 +54,20 @@ public:
 private:
 	CowData<Pair> _cowdata;
 
-	_FORCE_INLINE_ int _find(const T &p_val, bool &r_exact) const {
-		r_exact = false;
-		if (_cowdata.is_empty()) {
-			return 0;
-		}
-
-		int low = 0;
-		int high = _cowdata.size() - 1;
-		const Pair *a = _cowdata.ptr();
-		int middle = 0;
-
-#ifdef DEBUG_ENABLED
-		if (low > high) {
-			ERR_PRINT("low > high, this may be a bug");
-		}
-#endif
-		while (low <= high) {
-			middle = (low + high) / 2;
-
-			if (p_val < a[middle].key) {
-				high = middle - 1; // search low end of array
-			} else if (a[middle].key < p_val) {
-				low = middle + 1; // search high end of array
-			} else {
-				r_exact = true;
-				return middle;
-			}
-		}
+	struct _KeyCompare {
+		_FORCE_INLINE_ bool operator()(const Pair &p_a, const T &p_b) const { return p_a.key < p_b; }
+	};
 
-		// return the position where this would be inserted
-		if (a[middle].key < p_val) {
-			middle++;
-		}
-		return middle;
+	_FORCE_INLINE_ int _find(const T &p_val, bool &r_exact) const {
+		const int pos = SearchArray<Pair, _KeyCompare>().lower_bound(_cowdata.ptr(), _cowdata.size(), p_val);
+		r_exact = pos < _cowdata.size() && !(p_val < _cowdata.ptr()[pos].key);
+		return pos;
 	}
 
 	_FORCE_INLINE_ int _find_exact(const T &p_val) const {
-		if (_cowdata.is_empty()) {
-			return -1;
-		}
-
-		int low = 0;
-		int high = _cowdata.size() - 1;
-		int middle;
-		const Pair *a = _cowdata.ptr();
-
-		while (low <= high) {
-			middle = (low + high) / 2;
-
-			if (p_val < a[middle].key) {
-				high = middle - 1; // search low end of array
-			} else if (a[middle].key < p_val) {
-				low = middle + 1; // search high end of array
-			} else {
-				return middle;
-			}
-		}
-
-		return -1;
+		bool exact;
+		const int pos = _find(p_val, exact);
+		return exact ? pos : -1;
 	}
 
 public:
@@ -142,6 +98,21 @@ public:
 		return _find_exact(p_val);
 	}
 
+	// Same as calling find() for each of the p_count keys, storing the results in
+	// r_indices. Searches are interleaved, which is much faster for large maps.
+	void find_many(const T *p_keys, int p_count, int *r_indices) const {
+		ERR_FAIL_COND(p_count < 0);
+		const Pair *a = _cowdata.ptr();
+		const int size = _cowdata.size();
+		SearchArray<Pair, _KeyCompare>().lower_bound_many(a, size, p_keys, p_count, r_indices);
+		for (int i = 0; i < p_count; i++) {
+			const int pos = r_indices[i];
+			if (pos == size || p_keys[i] < a[pos].key) {
+				r_indices[i] = -1;
+			}
+		}
+	}
+
 	int find_nearest(const T &p_val) const {
 		bool exact;
 		return _find(p_val, exact);
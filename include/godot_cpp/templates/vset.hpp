@@ -40,65 +40,15 @@ class VSet {
 	Vector<T> _data;
 
 	_FORCE_INLINE_ int _find(const T &p_val, bool &r_exact) const {
-		r_exact = false;
-		if (_data.is_empty()) {
-			return 0;
-		}
-
-		int low = 0;
-		int high = _data.size() - 1;
-		const T *a = &_data[0];
-		int middle = 0;
-
-#ifdef DEBUG_ENABLED
-		if (low > high) {
-			ERR_PRINT("low > high, this may be a bug");
-		}
-#endif
-
-		while (low <= high) {
-			middle = (low + high) / 2;
-
-			if (p_val < a[middle]) {
-				high = middle - 1; // search low end of array
-			} else if (a[middle] < p_val) {
-				low = middle + 1; // search high end of array
-			} else {
-				r_exact = true;
-				return middle;
-			}
-		}
-
-		// return the position where this would be inserted
-		if (a[middle] < p_val) {
-			middle++;
-		}
-		return middle;
+		const int pos = SearchArray<T>().lower_bound(_data.ptr(), _data.size(), p_val);
+		r_exact = pos < _data.size() && !(p_val < _data.ptr()[pos]);
+		return pos;
 	}
 
 	_FORCE_INLINE_ int _find_exact(const T &p_val) const {
-		if (_data.is_empty()) {
-			return -1;
-		}
-
-		int low = 0;
-		int high = _data.size() - 1;
-		int middle;
-		const T *a = &_data[0];
-
-		while (low <= high) {
-			middle = (low + high) / 2;
-
-			if (p_val < a[middle]) {
-				high = middle - 1; // search low end of array
-			} else if (a[middle] < p_val) {
-				low = middle + 1; // search high end of array
-			} else {
-				return middle;
-			}
-		}
-
-		return -1;
+		bool exact;
+		const int pos = _find(p_val, exact);
+		return exact ? pos : -1;
 	}
 
 public:
@@ -127,6 +77,21 @@ public:
 		return _find_exact(p_val);
 	}
 
+	// Same as calling find() for each of the p_count keys, storing the results in
+	// r_indices. Searches are interleaved, which is much faster for large sets.
+	void find_many(const T *p_keys, int p_count, int *r_indices) const {
+		ERR_FAIL_COND(p_count < 0);
+		const T *a = _data.ptr();
+		const int size = _data.size();
+		SearchArray<T>().lower_bound_many(a, size, p_keys, p_count, r_indices);
+		for (int i = 0; i < p_count; i++) {
+			const int pos = r_indices[i];
+			if (pos == size || p_keys[i] < a[pos]) {
+				r_indices[i] = -1;
+			}
+		}
+	}
+
 	_FORCE_INLINE_ bool is_empty() const { return _data.is_empty(); }
 
 	_FORCE_INLINE_ int size() const { return _data.size(); }
@@ -30,67 +30,144 @@
 
 #include <godot_cpp/core/memory.hpp>
 
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/core/memory_pool.hpp>
+#include <godot_cpp/core/memory_profiler.hpp>
 #include <godot_cpp/godot.hpp>
 
+#include <cstring>
+
+#ifdef MEMORY_PROFILER_ENABLED
+// Allocations without a description are attributed to the caller of Memory::alloc_static.
+#if defined(__GNUC__) || defined(__clang__)
+#define _RETURN_ADDRESS() __builtin_return_address(0)
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define _RETURN_ADDRESS() _ReturnAddress()
+#else
+#define _RETURN_ADDRESS() nullptr
+#endif
+#endif
+
 namespace godot {
 
-void *Memory::alloc_static(size_t p_bytes, bool p_pad_align) {
-#ifdef DEBUG_ENABLED
-	bool prepad = false; // Already pre paded in the engine.
+#if defined(MEMORY_POOL_ENABLED) || defined(MEMORY_PROFILER_ENABLED)
+// Blocks served by the memory pool never go through the engine allocator, and
+// the profiler puts its own header in front of the data, so the prepad is
+// always done here, even in debug builds.
+#define _PREPAD(m_pad_align) (m_pad_align)
+#elif defined(DEBUG_ENABLED)
+#define _PREPAD(m_pad_align) false // Already pre paded in the engine.
 #else
-	bool prepad = p_pad_align;
+#define _PREPAD(m_pad_align) (m_pad_align)
 #endif
 
-	void *mem = internal::gdextension_interface_mem_alloc(p_bytes + (prepad ? DATA_OFFSET : 0));
+#ifdef MEMORY_POOL_ENABLED
+#define _MEM_ALLOC(m_size) MemoryPool::alloc(m_size)
+#define _MEM_REALLOC(m_mem, m_size) MemoryPool::realloc(m_mem, m_size)
+#define _MEM_FREE(m_mem) MemoryPool::free(m_mem)
+#else
+#define _MEM_ALLOC(m_size) internal::gdextension_interface_mem_alloc(m_size)
+#define _MEM_REALLOC(m_mem, m_size) internal::gdextension_interface_mem_realloc(m_mem, m_size)
+#define _MEM_FREE(m_mem) internal::gdextension_interface_mem_free(m_mem)
+#endif
+
+#ifdef MEMORY_PROFILER_ENABLED
+#define _PROFILER_HEADER_SIZE MemoryProfiler::HEADER_SIZE
+#else
+#define _PROFILER_HEADER_SIZE 0
+#endif
+
+void *Memory::alloc_static(size_t p_bytes, bool p_pad_align, const char *p_description) {
+	bool prepad = _PREPAD(p_pad_align);
+	size_t offset = (prepad ? DATA_OFFSET : 0) + _PROFILER_HEADER_SIZE;
+
+	uint8_t *mem = (uint8_t *)_MEM_ALLOC(p_bytes + offset);
 	ERR_FAIL_NULL_V(mem, nullptr);
 
-	if (prepad) {
-		uint8_t *s8 = (uint8_t *)mem;
-		return s8 + DATA_OFFSET;
-	} else {
-		return mem;
-	}
+#ifdef MEMORY_PROFILER_ENABLED
+	MemoryProfiler::record_alloc(mem, p_bytes, p_description, _RETURN_ADDRESS());
+#endif
+
+	return mem + offset;
 }
 
-void *Memory::realloc_static(void *p_memory, size_t p_bytes, bool p_pad_align) {
+void *Memory::realloc_static(void *p_memory, size_t p_bytes, bool p_pad_align, const char *p_description) {
 	if (p_memory == nullptr) {
-		return alloc_static(p_bytes, p_pad_align);
+		return alloc_static(p_bytes, p_pad_align, p_description);
 	} else if (p_bytes == 0) {
 		free_static(p_memory, p_pad_align);
 		return nullptr;
 	}
 
-	uint8_t *mem = (uint8_t *)p_memory;
+	bool prepad = _PREPAD(p_pad_align);
+	size_t offset = (prepad ? DATA_OFFSET : 0) + _PROFILER_HEADER_SIZE;
 
-#ifdef DEBUG_ENABLED
-	bool prepad = false; // Already pre paded in the engine.
-#else
-	bool prepad = p_pad_align;
+	uint8_t *mem = (uint8_t *)p_memory - offset;
+
+	mem = (uint8_t *)_MEM_REALLOC(mem, p_bytes + offset);
+	ERR_FAIL_NULL_V(mem, nullptr);
+
+#ifdef MEMORY_PROFILER_ENABLED
+	// The header was moved with the data, so the old size is still in it.
+	MemoryProfiler::record_free(mem);
+	MemoryProfiler::record_realloc(mem, p_bytes);
 #endif
 
-	if (prepad) {
-		mem -= DATA_OFFSET;
-		mem = (uint8_t *)internal::gdextension_interface_mem_realloc(mem, p_bytes + DATA_OFFSET);
-		ERR_FAIL_NULL_V(mem, nullptr);
-		return mem + DATA_OFFSET;
-	} else {
-		return (uint8_t *)internal::gdextension_interface_mem_realloc(mem, p_bytes);
-	}
+	return mem + offset;
 }
 
 void Memory::free_static(void *p_ptr, bool p_pad_align) {
 	uint8_t *mem = (uint8_t *)p_ptr;
 
-#ifdef DEBUG_ENABLED
-	bool prepad = false; // Already pre paded in the engine.
-#else
-	bool prepad = p_pad_align;
-#endif
+	bool prepad = _PREPAD(p_pad_align);
 
 	if (prepad) {
 		mem -= DATA_OFFSET;
 	}
-	internal::gdextension_interface_mem_free(mem);
+
+#ifdef MEMORY_PROFILER_ENABLED
+	mem -= _PROFILER_HEADER_SIZE;
+	MemoryProfiler::record_free(mem);
+#endif
+
+	_MEM_FREE(mem);
+}
+
+void *Memory::alloc_aligned_static(size_t p_bytes, size_t p_alignment, const char *p_description) {
+	DEV_ASSERT(p_alignment > 0 && (p_alignment & (p_alignment - 1)) == 0);
+
+	// Room for the offset to the start of the block, stored right before the aligned pointer.
+	p_alignment = MAX(p_alignment, alignof(uint32_t));
+
+	uint8_t *mem = (uint8_t *)alloc_static(p_bytes + p_alignment - 1 + sizeof(uint32_t), false, p_description);
+	ERR_FAIL_NULL_V(mem, nullptr);
+
+	uint8_t *aligned = (uint8_t *)(((uintptr_t)mem + sizeof(uint32_t) + p_alignment - 1) & ~((uintptr_t)p_alignment - 1));
+	*((uint32_t *)aligned - 1) = (uint32_t)(aligned - mem);
+	return aligned;
+}
+
+void *Memory::realloc_aligned_static(void *p_memory, size_t p_bytes, size_t p_prev_bytes, size_t p_alignment, const char *p_description) {
+	if (p_memory == nullptr) {
+		return alloc_aligned_static(p_bytes, p_alignment, p_description);
+	}
+
+	// The offset from the start of the block could change, so the data is always moved to a new block.
+	// On failure the old block is left untouched, like realloc.
+	void *mem = alloc_aligned_static(p_bytes, p_alignment, p_description);
+	ERR_FAIL_NULL_V(mem, nullptr);
+	memcpy(mem, p_memory, MIN(p_bytes, p_prev_bytes));
+	free_aligned_static(p_memory);
+	return mem;
+}
+
+void Memory::free_aligned_static(void *p_memory) {
+	if (p_memory == nullptr) {
+		return;
+	}
+	uint8_t *mem = (uint8_t *)p_memory - *((uint32_t *)p_memory - 1);
+	free_static(mem);
 }
 
 _GlobalNil::_GlobalNil() {
@@ -105,13 +182,22 @@ _GlobalNil _GlobalNilClass::_nil;
 
 // p_dummy argument is added to avoid conflicts with the engine functions when both engine and GDExtension are built as a static library on iOS.
 void *operator new(size_t p_size, const char *p_dummy, const char *p_description) {
-	return godot::Memory::alloc_static(p_size);
+	return godot::Memory::alloc_static(p_size, false, p_description);
 }
 
 void *operator new(size_t p_size, const char *p_dummy, void *(*p_allocfunc)(size_t p_size)) {
 	return p_allocfunc(p_size);
 }
 
+#ifdef MEMORY_PROFILER_ENABLED
+void *operator new(size_t p_size, const char *p_dummy, void *(*p_allocfunc)(size_t p_size), const char *p_description) {
+	godot::MemoryProfiler::push_site(p_description);
+	void *mem = p_allocfunc(p_size);
+	godot::MemoryProfiler::pop_site();
+	return mem;
+}
+#endif
+
 using namespace godot;
 
 #ifdef _MSC_VER
@@ -125,6 +211,13 @@ void operator delete(void *p_mem, const char *p_dummy, void *(*p_allocfunc)(size
 	CRASH_NOW();
 }
 
+#ifdef MEMORY_PROFILER_ENABLED
+void operator delete(void *p_mem, const char *p_dummy, void *(*p_allocfunc)(size_t p_size), const char *p_description) {
+	ERR_PRINT("Call to placement delete should not happen.");
+	CRASH_NOW();
+}
+#endif
+
 void operator delete(void *p_mem, const char *p_dummy, void *p_pointer, size_t check, const char *p_description) {
 	ERR_PRINT("Call to placement delete should not happen.");
 	CRASH_NOW();
@@ -0,0 +1,277 @@
+/**************************************************************************/
+/*  memory_pool.cpp                                                       */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include <godot_cpp/core/memory_pool.hpp>
+
+#ifdef MEMORY_POOL_ENABLED
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/godot.hpp>
+#include <godot_cpp/templates/spin_lock.hpp>
+
+#include <atomic>
+#include <cstring>
+
+// Same restriction as `_GODOT_CPP_AVOID_THREAD_LOCAL` in wrapped.hpp: the library
+// can't be unloaded for hot reload on macOS if it uses thread locals.
+#if defined(MACOS_ENABLED) && defined(HOT_RELOAD_ENABLED)
+#define _MEMORY_POOL_NO_THREAD_CACHE
+#endif
+
+namespace godot {
+
+namespace {
+
+struct BlockHeader {
+	uint32_t size_class;
+};
+
+// Stored in the payload of blocks that are not in use.
+struct FreeBlock {
+	FreeBlock *next;
+};
+
+struct SharedSizeClass {
+	SpinLock lock;
+	FreeBlock *free_list;
+	uint32_t free_count;
+	uint8_t *slab_pos;
+	uint8_t *slab_end;
+};
+
+// No initializers besides the locks, so nothing allocated by static constructors
+// of other translation units is lost when this one is initialized.
+SharedSizeClass shared_size_classes[MemoryPool::SIZE_CLASS_COUNT];
+std::atomic<uint64_t> slab_memory;
+
+#ifndef _MEMORY_POOL_NO_THREAD_CACHE
+struct ThreadCache {
+	FreeBlock *free_list[MemoryPool::SIZE_CLASS_COUNT];
+	uint32_t free_count[MemoryPool::SIZE_CLASS_COUNT];
+};
+
+// Trivially destructible on purpose, no thread exit callback is registered.
+// See MemoryPool::flush_thread_cache().
+thread_local ThreadCache thread_cache;
+#endif
+
+_FORCE_INLINE_ BlockHeader *_get_header(void *p_ptr) {
+	return (BlockHeader *)((uint8_t *)p_ptr - MemoryPool::HEADER_SIZE);
+}
+
+// Amount of blocks moved between a thread cache and the shared pool at once, about 8 KiB.
+_FORCE_INLINE_ uint32_t _get_batch_count(uint32_t p_size_class) {
+	const uint32_t count = uint32_t(8192 / (MemoryPool::HEADER_SIZE + MemoryPool::get_size_class_bytes(p_size_class)));
+	return CLAMP(count, 4u, 64u);
+}
+
+// Pops up to p_count blocks from the shared pool, carving new ones from a slab if the free list is empty.
+// Returns the number of blocks in the chain stored in r_head.
+uint32_t _pop_shared(uint32_t p_size_class, uint32_t p_count, FreeBlock *&r_head) {
+	SharedSizeClass &sc = shared_size_classes[p_size_class];
+	uint32_t count = 0;
+	r_head = nullptr;
+
+	sc.lock.lock();
+
+	if (sc.free_list) {
+		FreeBlock *tail = sc.free_list;
+		count = 1;
+		while (count < p_count && tail->next) {
+			tail = tail->next;
+			count++;
+		}
+		r_head = sc.free_list;
+		sc.free_list = tail->next;
+		sc.free_count -= count;
+		tail->next = nullptr;
+
+		sc.lock.unlock();
+		return count;
+	}
+
+	const size_t stride = MemoryPool::HEADER_SIZE + MemoryPool::get_size_class_bytes(p_size_class);
+	if (sc.slab_pos + stride > sc.slab_end) {
+		// The tail of the previous slab, if any, is too small for a block and is wasted.
+		uint8_t *slab = (uint8_t *)internal::gdextension_interface_mem_alloc(MemoryPool::SLAB_SIZE);
+		if (unlikely(!slab)) {
+			sc.lock.unlock();
+			ERR_FAIL_V_MSG(0, "Out of memory.");
+		}
+		slab_memory.fetch_add(MemoryPool::SLAB_SIZE, std::memory_order_relaxed);
+		sc.slab_pos = slab;
+		sc.slab_end = slab + MemoryPool::SLAB_SIZE;
+	}
+
+	FreeBlock *tail = nullptr;
+	while (count < p_count && sc.slab_pos + stride <= sc.slab_end) {
+		((BlockHeader *)sc.slab_pos)->size_class = p_size_class;
+		FreeBlock *block = (FreeBlock *)(sc.slab_pos + MemoryPool::HEADER_SIZE);
+		block->next = nullptr;
+		if (tail) {
+			tail->next = block;
+		} else {
+			r_head = block;
+		}
+		tail = block;
+		sc.slab_pos += stride;
+		count++;
+	}
+
+	sc.lock.unlock();
+	return count;
+}
+
+void _push_shared(uint32_t p_size_class, FreeBlock *p_head, FreeBlock *p_tail, uint32_t p_count) {
+	SharedSizeClass &sc = shared_size_classes[p_size_class];
+
+	sc.lock.lock();
+	p_tail->next = sc.free_list;
+	sc.free_list = p_head;
+	sc.free_count += p_count;
+	sc.lock.unlock();
+}
+
+} // namespace
+
+void *MemoryPool::alloc(size_t p_bytes) {
+	if (p_bytes > MAX_SMALL_SIZE) {
+		uint8_t *mem = (uint8_t *)internal::gdextension_interface_mem_alloc(p_bytes + HEADER_SIZE);
+		ERR_FAIL_NULL_V(mem, nullptr);
+		((BlockHeader *)mem)->size_class = LARGE_SIZE_CLASS;
+		return mem + HEADER_SIZE;
+	}
+
+	const uint32_t size_class = get_size_class(p_bytes);
+	FreeBlock *block = nullptr;
+
+#ifndef _MEMORY_POOL_NO_THREAD_CACHE
+	ThreadCache &cache = thread_cache;
+	block = cache.free_list[size_class];
+	if (unlikely(!block)) {
+		cache.free_count[size_class] = _pop_shared(size_class, _get_batch_count(size_class), block);
+		ERR_FAIL_NULL_V(block, nullptr);
+	}
+	cache.free_list[size_class] = block->next;
+	cache.free_count[size_class]--;
+#else
+	_pop_shared(size_class, 1, block);
+	ERR_FAIL_NULL_V(block, nullptr);
+#endif
+
+	return block;
+}
+
+void *MemoryPool::realloc(void *p_memory, size_t p_bytes) {
+	if (p_memory == nullptr) {
+		return alloc(p_bytes);
+	}
+
+	BlockHeader *header = _get_header(p_memory);
+	if (header->size_class == LARGE_SIZE_CLASS) {
+		uint8_t *mem = (uint8_t *)internal::gdextension_interface_mem_realloc(header, p_bytes + HEADER_SIZE);
+		ERR_FAIL_NULL_V(mem, nullptr);
+		return mem + HEADER_SIZE;
+	}
+
+	const size_t current_bytes = get_size_class_bytes(header->size_class);
+	if (p_bytes <= current_bytes && p_bytes > current_bytes / 2) {
+		return p_memory; // Still a good fit, keep the block.
+	}
+
+	void *mem = alloc(p_bytes);
+	ERR_FAIL_NULL_V(mem, nullptr);
+	memcpy(mem, p_memory, MIN(current_bytes, p_bytes));
+	free(p_memory);
+	return mem;
+}
+
+void MemoryPool::free(void *p_ptr) {
+	if (p_ptr == nullptr) {
+		return;
+	}
+
+	BlockHeader *header = _get_header(p_ptr);
+	const uint32_t size_class = header->size_class;
+	if (size_class == LARGE_SIZE_CLASS) {
+		internal::gdextension_interface_mem_free(header);
+		return;
+	}
+
+	FreeBlock *block = (FreeBlock *)p_ptr;
+
+#ifndef _MEMORY_POOL_NO_THREAD_CACHE
+	ThreadCache &cache = thread_cache;
+	block->next = cache.free_list[size_class];
+	cache.free_list[size_class] = block;
+
+	const uint32_t batch = _get_batch_count(size_class);
+	if (unlikely(++cache.free_count[size_class] > batch * 2)) {
+		// Give a batch back, so memory freed by this thread can be reused by the others.
+		FreeBlock *tail = block;
+		for (uint32_t i = 1; i < batch; i++) {
+			tail = tail->next;
+		}
+		cache.free_list[size_class] = tail->next;
+		cache.free_count[size_class] -= batch;
+		_push_shared(size_class, block, tail, batch);
+	}
+#else
+	_push_shared(size_class, block, block, 1);
+#endif
+}
+
+void MemoryPool::flush_thread_cache() {
+#ifndef _MEMORY_POOL_NO_THREAD_CACHE
+	ThreadCache &cache = thread_cache;
+	for (uint32_t i = 0; i < SIZE_CLASS_COUNT; i++) {
+		FreeBlock *head = cache.free_list[i];
+		if (!head) {
+			continue;
+		}
+		FreeBlock *tail = head;
+		while (tail->next) {
+			tail = tail->next;
+		}
+		_push_shared(i, head, tail, cache.free_count[i]);
+		cache.free_list[i] = nullptr;
+		cache.free_count[i] = 0;
+	}
+#endif
+}
+
+uint64_t MemoryPool::get_slab_memory() {
+	return slab_memory.load(std::memory_order_relaxed);
+}
+
+} // namespace godot
+
+#endif // MEMORY_POOL_ENABLED
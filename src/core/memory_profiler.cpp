@@ -0,0 +1,364 @@
+/**************************************************************************/
+/*  memory_profiler.cpp                                                   */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include <godot_cpp/core/memory_profiler.hpp>
+
+#ifdef MEMORY_PROFILER_ENABLED
+
+#include <godot_cpp/core/error_macros.hpp>
+#include <godot_cpp/core/math.hpp>
+#include <godot_cpp/godot.hpp>
+#include <godot_cpp/templates/sort_array.hpp>
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+// Same restriction as `_GODOT_CPP_AVOID_THREAD_LOCAL` in wrapped.hpp: the library
+// can't be unloaded for hot reload on macOS if it uses thread locals.
+#if defined(MACOS_ENABLED) && defined(HOT_RELOAD_ENABLED)
+#define _MEMORY_PROFILER_NO_THREAD_LOCAL
+#endif
+
+namespace godot {
+
+namespace {
+
+enum SiteKind : uint32_t {
+	SITE_KIND_NONE,
+	SITE_KIND_DESCRIPTION,
+	SITE_KIND_ADDRESS,
+	SITE_KIND_OVERFLOW,
+};
+
+struct Site {
+	std::atomic<const void *> key; // Description string or return address.
+	std::atomic<uint32_t> kind;
+	std::atomic<uint64_t> live_bytes;
+	std::atomic<uint64_t> live_count;
+	std::atomic<uint64_t> total_bytes;
+	std::atomic<uint64_t> total_count;
+	std::atomic<uint64_t> thread_mask;
+	// Only accessed by next_frame() and the queries.
+	uint64_t frame_start_bytes;
+	uint64_t frame_start_count;
+	uint64_t frame_bytes;
+	uint64_t frame_count;
+};
+
+struct AllocHeader {
+	Site *site;
+	uint64_t bytes;
+	uint64_t thread;
+};
+
+static_assert(sizeof(AllocHeader) <= MemoryProfiler::HEADER_SIZE);
+static_assert((MemoryProfiler::MAX_SITES & (MemoryProfiler::MAX_SITES - 1)) == 0, "MAX_SITES must be a power of 2.");
+
+// Constant initialized, so allocations made by static constructors of other
+// translation units are recorded no matter the initialization order.
+Site sites[MemoryProfiler::MAX_SITES];
+Site overflow_site = { {}, { SITE_KIND_OVERFLOW } };
+
+#ifndef _MEMORY_PROFILER_NO_THREAD_LOCAL
+thread_local const char *pending_description = nullptr;
+#endif
+
+constexpr uint32_t MAX_PROBES = 64;
+
+_FORCE_INLINE_ uint64_t _mix(uint64_t p_value) {
+	p_value ^= p_value >> 33;
+	p_value *= 0xff51afd7ed558ccdULL;
+	p_value ^= p_value >> 33;
+	return p_value;
+}
+
+_FORCE_INLINE_ uint64_t _get_thread_id() {
+	return _mix(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+Site *_get_site(const void *p_key, uint32_t p_kind) {
+	const uint32_t hash = uint32_t(_mix(uint64_t(uintptr_t(p_key))));
+	for (uint32_t i = 0; i < MAX_PROBES; i++) {
+		Site &site = sites[(hash + i) & (MemoryProfiler::MAX_SITES - 1)];
+		const void *key = site.key.load(std::memory_order_acquire);
+		if (key == nullptr) {
+			if (site.key.compare_exchange_strong(key, p_key, std::memory_order_acq_rel)) {
+				site.kind.store(p_kind, std::memory_order_release);
+				return &site;
+			}
+		}
+		if (key == p_key) {
+			return &site;
+		}
+	}
+	return &overflow_site;
+}
+
+void _add(Site *p_site, uint64_t p_bytes, uint64_t p_thread) {
+	p_site->live_bytes.fetch_add(p_bytes, std::memory_order_relaxed);
+	p_site->live_count.fetch_add(1, std::memory_order_relaxed);
+	p_site->total_bytes.fetch_add(p_bytes, std::memory_order_relaxed);
+	p_site->total_count.fetch_add(1, std::memory_order_relaxed);
+
+	const uint64_t thread_bit = uint64_t(1) << (p_thread & 63);
+	if (!(p_site->thread_mask.load(std::memory_order_relaxed) & thread_bit)) {
+		p_site->thread_mask.fetch_or(thread_bit, std::memory_order_relaxed);
+	}
+}
+
+void _get_info(const Site &p_site, uint32_t p_kind, MemoryProfiler::SiteInfo &r_info) {
+	r_info = MemoryProfiler::SiteInfo();
+	const void *key = p_site.key.load(std::memory_order_relaxed);
+	if (p_kind == SITE_KIND_DESCRIPTION) {
+		r_info.description = (const char *)key;
+	} else if (p_kind == SITE_KIND_ADDRESS) {
+		r_info.address = key;
+	} else {
+		r_info.description = "<overflow>";
+	}
+	r_info.live_bytes = p_site.live_bytes.load(std::memory_order_relaxed);
+	r_info.live_count = p_site.live_count.load(std::memory_order_relaxed);
+	r_info.total_bytes = p_site.total_bytes.load(std::memory_order_relaxed);
+	r_info.total_count = p_site.total_count.load(std::memory_order_relaxed);
+	r_info.frame_bytes = p_site.frame_bytes;
+	r_info.frame_count = p_site.frame_count;
+
+	uint64_t mask = p_site.thread_mask.load(std::memory_order_relaxed);
+	while (mask) {
+		mask &= mask - 1;
+		r_info.thread_count++;
+	}
+}
+
+struct SiteDescriptionComparator {
+	_FORCE_INLINE_ bool operator()(const MemoryProfiler::SiteInfo &p_a, const MemoryProfiler::SiteInfo &p_b) const {
+		if (!p_a.description || !p_b.description) {
+			return p_a.description == nullptr && p_b.description != nullptr;
+		}
+		return strcmp(p_a.description, p_b.description) < 0;
+	}
+};
+
+struct SiteLiveBytesComparator {
+	_FORCE_INLINE_ bool operator()(const MemoryProfiler::SiteInfo &p_a, const MemoryProfiler::SiteInfo &p_b) const {
+		if (p_a.live_bytes != p_b.live_bytes) {
+			return p_a.live_bytes > p_b.live_bytes;
+		}
+		return p_a.total_bytes > p_b.total_bytes;
+	}
+};
+
+// Returns the merged sites sorted by live bytes in a buffer to release with gdextension_interface_mem_free.
+// The buffer is requested from the engine directly so the queries don't show up in the results.
+uint32_t _collect_sites(MemoryProfiler::SiteInfo *&r_infos) {
+	r_infos = (MemoryProfiler::SiteInfo *)internal::gdextension_interface_mem_alloc(sizeof(MemoryProfiler::SiteInfo) * (MemoryProfiler::MAX_SITES + 1));
+	ERR_FAIL_NULL_V(r_infos, 0);
+
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < MemoryProfiler::MAX_SITES; i++) {
+		const uint32_t kind = sites[i].kind.load(std::memory_order_acquire);
+		if (kind != SITE_KIND_NONE) {
+			_get_info(sites[i], kind, r_infos[count++]);
+		}
+	}
+	if (overflow_site.total_count.load(std::memory_order_relaxed)) {
+		_get_info(overflow_site, SITE_KIND_OVERFLOW, r_infos[count++]);
+	}
+
+	// The same `file:line` string may have a different address in each translation unit.
+	SortArray<MemoryProfiler::SiteInfo, SiteDescriptionComparator> description_sorter;
+	description_sorter.sort(r_infos, count);
+
+	uint32_t merged = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		MemoryProfiler::SiteInfo &info = r_infos[i];
+		if (merged > 0 && info.description) {
+			MemoryProfiler::SiteInfo &prev = r_infos[merged - 1];
+			if (prev.description && strcmp(prev.description, info.description) == 0) {
+				prev.live_bytes += info.live_bytes;
+				prev.live_count += info.live_count;
+				prev.total_bytes += info.total_bytes;
+				prev.total_count += info.total_count;
+				prev.frame_bytes += info.frame_bytes;
+				prev.frame_count += info.frame_count;
+				prev.thread_count = MAX(prev.thread_count, info.thread_count);
+				continue;
+			}
+		}
+		r_infos[merged++] = info;
+	}
+
+	SortArray<MemoryProfiler::SiteInfo, SiteLiveBytesComparator> live_bytes_sorter;
+	live_bytes_sorter.sort(r_infos, merged);
+	return merged;
+}
+
+} // namespace
+
+void MemoryProfiler::record_alloc(void *p_header, size_t p_bytes, const char *p_description, const void *p_address) {
+	Site *site;
+	if (p_description && p_description[0]) {
+		site = _get_site(p_description, SITE_KIND_DESCRIPTION);
+#ifndef _MEMORY_PROFILER_NO_THREAD_LOCAL
+	} else if (pending_description) {
+		site = _get_site(pending_description, SITE_KIND_DESCRIPTION);
+#endif
+	} else {
+		site = _get_site(p_address, SITE_KIND_ADDRESS);
+	}
+
+	AllocHeader *header = (AllocHeader *)p_header;
+	header->site = site;
+	header->bytes = p_bytes;
+	header->thread = _get_thread_id();
+	_add(site, p_bytes, header->thread);
+}
+
+void MemoryProfiler::record_free(void *p_header) {
+	AllocHeader *header = (AllocHeader *)p_header;
+	header->site->live_bytes.fetch_sub(header->bytes, std::memory_order_relaxed);
+	header->site->live_count.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void MemoryProfiler::record_realloc(void *p_header, size_t p_bytes) {
+	AllocHeader *header = (AllocHeader *)p_header;
+	header->bytes = p_bytes;
+	header->thread = _get_thread_id();
+	_add(header->site, p_bytes, header->thread);
+}
+
+const char *MemoryProfiler::get_type_description(const char *p_type_name) {
+#ifdef __GNUC__
+	int status = 0;
+	// Allocated with malloc, so it isn't recorded itself.
+	char *demangled = abi::__cxa_demangle(p_type_name, nullptr, nullptr, &status);
+	if (status == 0 && demangled) {
+		return demangled;
+	}
+#endif
+	return p_type_name; // Already readable with MSVC.
+}
+
+void MemoryProfiler::push_site(const char *p_description) {
+#ifndef _MEMORY_PROFILER_NO_THREAD_LOCAL
+	pending_description = p_description;
+#endif
+}
+
+void MemoryProfiler::pop_site() {
+#ifndef _MEMORY_PROFILER_NO_THREAD_LOCAL
+	pending_description = nullptr;
+#endif
+}
+
+void MemoryProfiler::next_frame() {
+	for (uint32_t i = 0; i <= MAX_SITES; i++) {
+		Site &site = i < MAX_SITES ? sites[i] : overflow_site;
+		if (site.kind.load(std::memory_order_acquire) == SITE_KIND_NONE) {
+			continue;
+		}
+		const uint64_t total_bytes = site.total_bytes.load(std::memory_order_relaxed);
+		const uint64_t total_count = site.total_count.load(std::memory_order_relaxed);
+		site.frame_bytes = total_bytes - site.frame_start_bytes;
+		site.frame_count = total_count - site.frame_start_count;
+		site.frame_start_bytes = total_bytes;
+		site.frame_start_count = total_count;
+	}
+}
+
+uint32_t MemoryProfiler::get_top_sites(SiteInfo *r_sites, uint32_t p_max) {
+	SiteInfo *infos = nullptr;
+	const uint32_t count = MIN(_collect_sites(infos), p_max);
+	for (uint32_t i = 0; i < count; i++) {
+		r_sites[i] = infos[i];
+	}
+	internal::gdextension_interface_mem_free(infos);
+	return count;
+}
+
+bool MemoryProfiler::dump(const char *p_path) {
+	FILE *file = fopen(p_path, "w");
+	ERR_FAIL_NULL_V_MSG(file, false, "Can't open memory profile file for writing.");
+
+	SiteInfo *infos = nullptr;
+	const uint32_t count = _collect_sites(infos);
+
+	uint64_t live_bytes = 0;
+	uint64_t live_count = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		live_bytes += infos[i].live_bytes;
+		live_count += infos[i].live_count;
+	}
+
+	fprintf(file, "# %" PRIu64 " bytes live in %" PRIu64 " allocations from %u sites.\n", live_bytes, live_count, count);
+	fprintf(file, "# live_bytes\tlive_count\ttotal_bytes\ttotal_count\tframe_bytes\tframe_count\tthreads\tsite\n");
+	for (uint32_t i = 0; i < count; i++) {
+		const SiteInfo &info = infos[i];
+		fprintf(file, "%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%u\t",
+				info.live_bytes, info.live_count, info.total_bytes, info.total_count, info.frame_bytes, info.frame_count, info.thread_count);
+		if (info.description) {
+			fprintf(file, "%s\n", info.description);
+		} else {
+			fprintf(file, "%p\n", info.address);
+		}
+	}
+
+	internal::gdextension_interface_mem_free(infos);
+	fclose(file);
+	return true;
+}
+
+uint64_t MemoryProfiler::get_live_bytes() {
+	uint64_t bytes = overflow_site.live_bytes.load(std::memory_order_relaxed);
+	for (uint32_t i = 0; i < MAX_SITES; i++) {
+		bytes += sites[i].live_bytes.load(std::memory_order_relaxed);
+	}
+	return bytes;
+}
+
+uint64_t MemoryProfiler::get_live_count() {
+	uint64_t count = overflow_site.live_count.load(std::memory_order_relaxed);
+	for (uint32_t i = 0; i < MAX_SITES; i++) {
+		count += sites[i].live_count.load(std::memory_order_relaxed);
+	}
+	return count;
+}
+
+} // namespace godot
+
+#endif // MEMORY_PROFILER_ENABLED
@@ -6,22 +6,38 @@
 #ifndef TESTS_H
 #define TESTS_H
 
+#include <godot_cpp/templates/arena_allocator.hpp>
+#include <godot_cpp/templates/b_tree_map.hpp>
+#include <godot_cpp/templates/concurrent_hash_map.hpp>
+#include <godot_cpp/templates/coroutine.hpp>
 #include <godot_cpp/templates/cowdata.hpp>
+#include <godot_cpp/templates/flat_hash_map.hpp>
+#include <godot_cpp/templates/flat_hash_set.hpp>
 #include <godot_cpp/templates/hash_map.hpp>
 #include <godot_cpp/templates/hash_set.hpp>
 #include <godot_cpp/templates/hashfuncs.hpp>
 #include <godot_cpp/templates/list.hpp>
 #include <godot_cpp/templates/local_vector.hpp>
+#include <godot_cpp/templates/mpmc_queue.hpp>
+#include <godot_cpp/templates/paged_allocator.hpp>
 #include <godot_cpp/templates/pair.hpp>
+#include <godot_cpp/templates/parallel_sort_array.hpp>
+#include <godot_cpp/templates/pdq_sort_array.hpp>
+#include <godot_cpp/templates/radix_sort.hpp>
 #include <godot_cpp/templates/rb_map.hpp>
 #include <godot_cpp/templates/rb_set.hpp>
 #include <godot_cpp/templates/rid_owner.hpp>
 #include <godot_cpp/templates/safe_refcount.hpp>
 #include <godot_cpp/templates/search_array.hpp>
 #include <godot_cpp/templates/self_list.hpp>
+#include <godot_cpp/templates/slot_map.hpp>
+#include <godot_cpp/templates/small_vector.hpp>
 #include <godot_cpp/templates/sort_array.hpp>
 #include <godot_cpp/templates/spin_lock.hpp>
+#include <godot_cpp/templates/spsc_queue.hpp>
+#include <godot_cpp/templates/task_graph.hpp>
 #include <godot_cpp/templates/thread_work_pool.hpp>
+#include <godot_cpp/templates/unique_vector.hpp>
 #include <godot_cpp/templates/vector.hpp>
 #include <godot_cpp/templates/vmap.hpp>
 #include <godot_cpp/templates/vset.hpp>
@@ -302,6 +302,30 @@ def options(opts, env):
 
     opts.Add(BoolVariable(key="threads", help="Enable threading support", default=env.get("threads", True)))
 
+    opts.Add(
+        BoolVariable(
+            key="use_memory_pool",
+            help="Serve small allocations from an extension-side pool with per-thread caches instead of the engine allocator.",
+            default=env.get("use_memory_pool", False),
+        )
+    )
+
+    opts.Add(
+        BoolVariable(
+            key="use_memory_profiler",
+            help="Record the call site, size and thread of every allocation made through Memory (see MemoryProfiler).",
+            default=env.get("use_memory_profiler", False),
+        )
+    )
+
+    opts.Add(
+        BoolVariable(
+            key="use_spin_lock_stats",
+            help="Count acquisitions, contentions, spins and the longest wait of every SpinLock and RWSpinLock.",
+            default=env.get("use_spin_lock_stats", False),
+        )
+    )
+
     # compiledb
     opts.Add(
         BoolVariable(
@@ -452,6 +476,15 @@ def generate(env):
     if env.use_hot_reload:
         env.Append(CPPDEFINES=["HOT_RELOAD_ENABLED"])
 
+    if env["use_memory_pool"]:
+        env.Append(CPPDEFINES=["MEMORY_POOL_ENABLED"])
+
+    if env["use_memory_profiler"]:
+        env.Append(CPPDEFINES=["MEMORY_PROFILER_ENABLED"])
+
+    if env["use_spin_lock_stats"]:
+        env.Append(CPPDEFINES=["SPIN_LOCK_STATS_ENABLED"])
+
     if env.editor_build:
         env.Append(CPPDEFINES=["TOOLS_ENABLED"])
 